@@ -1,22 +1,100 @@
 // BenchmarkTool.cpp
 #include "BenchmarkTool.h"
+#include "../cpp/AsyncCSVWriter.h"
+#include "../cpp/BinaryLogHandler.h"
 #include "../cpp/CSVHandler.h"
+#include "../cpp/MappedCSVWriter.h"
+#include "../cpp/ShardedCSVWriter.h"
 #include "../cpp/ProducerConsumerConcurrentIO.h"
 #include "../cpp/TaskQueue.h"
+#include "../cpp/util/AllocationCounter.h"
+#include "../cpp/util/CSVParser.h"
+#include "../cpp/util/CSVQuery.h"
+#include "../cpp/util/CycleClock.h"
+#include "../cpp/util/TraceRecorder.h"
+#include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace std;
 
 std::mutex BenchmarkTool::statsMutex;
 std::mutex BenchmarkTool::coutMutex;
 
+namespace {
+string durabilityName(Durability durability) {
+  switch (durability) {
+  case Durability::None:
+    return "None";
+  case Durability::Flush:
+    return "Flush";
+  case Durability::FDataSync:
+    return "FDataSync";
+  }
+  return "Unknown";
+}
+
+// write rows shaped like the consumers' output until the file reaches
+// targetBytes, returns the number of rows written
+long writeSampleCSV(const string &filePath, long targetBytes) {
+  ofstream file(filePath, ios::trunc);
+  if (!file.is_open()) {
+    throw runtime_error("Cannot create sample file: " + filePath);
+  }
+  long written = 0;
+  long rows = 0;
+  while (written < targetBytes) {
+    string row = to_string(rows) + ",Task " + to_string(rows) +
+                 (rows % 2 == 0 ? ",Complete\n" : ",Pending\n");
+    file << row;
+    written += row.size();
+    rows++;
+  }
+  return rows;
+}
+
+// bytes of the file currently in the page cache, from mincore over a
+// mapping of the whole file
+long residentBytes(const string &filePath) {
+  int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  long fileSize = lseek(fd, 0, SEEK_END);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  long resident = -1;
+  void *address = fileSize > 0
+                      ? mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0)
+                      : MAP_FAILED;
+  if (address != MAP_FAILED) {
+    vector<unsigned char> pages((fileSize + pageSize - 1) / pageSize);
+    if (mincore(address, fileSize, pages.data()) == 0) {
+      resident = 0;
+      for (unsigned char page : pages) {
+        resident += (page & 1) ? pageSize : 0;
+      }
+    }
+    munmap(address, fileSize);
+  }
+  close(fd);
+  return resident;
+}
+} // namespace
+
 // Corrected to use make_shared
 shared_ptr<TaskQueue> BenchmarkTool::createTaskQueue(const string &lockType) {
   if (lockType == "MutexLock") {
@@ -75,6 +153,7 @@ vector<BenchmarkTool::BenchmarkResult> BenchmarkTool::runThreadBenchmark(
         result.totalTime =
             chrono::duration_cast<chrono::microseconds>(end - start).count();
         results.push_back(result);
+        exportTrace(result);
       }
     }
   }
@@ -118,6 +197,7 @@ vector<BenchmarkTool::BenchmarkResult> BenchmarkTool::runIOBenchmark(
           collectIOStatistics(csvHandler, result);
 
           results.push_back(result);
+          exportTrace(result);
 
           cout << "Recorded BenchmarkResult for LockType: " << lockType
                << ", Writers: " << writerCount << ", Readers: " << readerCount
@@ -131,6 +211,69 @@ vector<BenchmarkTool::BenchmarkResult> BenchmarkTool::runIOBenchmark(
   return results;
 }
 
+// Run the durability benchmark: writerCount threads each call writeRow
+// rowsPerWriter times, so concurrent rows can share a group commit.
+// "AtomicAppend" writes without a lock through O_APPEND.
+vector<BenchmarkTool::BenchmarkResult> BenchmarkTool::runDurabilityBenchmark(
+    const vector<string> &lockTypes, const vector<Durability> &durabilities,
+    const vector<int> &writerCounts, int rowsPerWriter) {
+  vector<BenchmarkResult> results;
+  const string filePath = "test_durability.csv";
+
+  for (const auto &lockType : lockTypes) {
+    for (Durability durability : durabilities) {
+      for (int writerCount : writerCounts) {
+        LockType lockTypeEnum =
+            lockType == "RWLock" ? LockType::RWLock : LockType::Mutex;
+        CSVHandler csvHandler(filePath, lockTypeEnum);
+        if (lockType == "AtomicAppend") {
+          csvHandler.setWriteMode(WriteMode::AtomicAppend);
+        }
+        csvHandler.setDurability(durability);
+
+        BenchmarkResult result;
+        result.testName = "Durability Test";
+        result.lockType = lockType;
+        result.durability = durabilityName(durability);
+        result.consumerCount = writerCount;
+        result.operationCount = writerCount * rowsPerWriter;
+
+        auto start = chrono::high_resolution_clock::now();
+        vector<thread> writers;
+        for (int i = 0; i < writerCount; ++i) {
+          writers.emplace_back([&csvHandler, rowsPerWriter, i]() {
+            for (int j = 0; j < rowsPerWriter; ++j) {
+              csvHandler.writeRow(
+                  {"Writer_" + to_string(i), "Row_" + to_string(j)});
+            }
+          });
+        }
+        for (auto &writer : writers) {
+          writer.join();
+        }
+        csvHandler.flush();
+        auto end = chrono::high_resolution_clock::now();
+
+        result.totalTime =
+            chrono::duration_cast<chrono::microseconds>(end - start).count();
+        collectIOStatistics(csvHandler, result);
+        results.push_back(result);
+        exportTrace(result);
+
+        cout << "Recorded BenchmarkResult for LockType: " << lockType
+             << ", Durability: " << result.durability
+             << ", Writers: " << writerCount
+             << ", OperationCount: " << result.operationCount
+             << ", TotalTime: " << result.totalTime << " us" << endl;
+        csvHandler.clear();
+      }
+    }
+  }
+
+  filesystem::remove(filePath);
+  return results;
+}
+
 // Export thread benchmark results to CSV
 void BenchmarkTool::exportThreadResultsToCSV(
     const string &filePath, const vector<BenchmarkResult> &results) {
@@ -186,6 +329,33 @@ void BenchmarkTool::exportIOResultsToCSV(
   file.close();
 }
 
+// Export durability benchmark results to CSV
+void BenchmarkTool::exportDurabilityResultsToCSV(
+    const string &filePath, const vector<BenchmarkResult> &results) {
+  ofstream file(filePath);
+  if (!file.is_open()) {
+    cerr << "Failed to open CSV file for writing: " << filePath << endl;
+    return;
+  }
+
+  file << "TestName,LockType,Durability,WriterCount,OperationCount,"
+          "TotalTime(us),TotalWriteTime(us),AvgBatchSize,SyncCount,"
+          "SyncP50(us),SyncP99(us),BatchSizeHistogram,"
+          "SyncLatencyHistogram(us)\n";
+
+  for (const auto &result : results) {
+    file << result.testName << "," << result.lockType << ","
+         << result.durability << "," << result.consumerCount << ","
+         << result.operationCount << "," << result.totalTime << ","
+         << result.totalWriteTime << "," << result.avgBatchSize << ","
+         << result.syncCount << "," << result.syncP50Time << ","
+         << result.syncP99Time << "," << result.batchSizeHistogram << ","
+         << result.syncLatencyHistogram << "\n";
+  }
+
+  file.close();
+}
+
 //--
 // ---------------------------------------------------
 // Collect statistics for thread benchmark
@@ -244,6 +414,36 @@ void BenchmarkTool::collectIOStatistics(CSVHandler &csvHandler,
 
   result.totalWriteTime = csvHandler.getTotalWriteTime();
   result.totalReadTime = csvHandler.getTotalReadTime();
+
+  // group commit batch sizes and fdatasync latency
+  const Histogram &batchSizes = csvHandler.getBatchSizeHistogram();
+  const Histogram &syncLatency = csvHandler.getSyncLatencyHistogram();
+  result.avgBatchSize = batchSizes.getMean();
+  result.syncCount = syncLatency.getCount();
+  result.syncP50Time = syncLatency.getPercentile(50);
+  result.syncP99Time = syncLatency.getPercentile(99);
+  result.batchSizeHistogram = batchSizes.toString();
+  result.syncLatencyHistogram = syncLatency.toString();
+}
+
+// Flush trace events of one run, one file per configuration
+void BenchmarkTool::exportTrace(const BenchmarkResult &result) {
+  if (!TraceRecorder::isEnabled()) {
+    return;
+  }
+
+  string fileName = "Trace_" + result.testName + "_" + result.lockType + "_" +
+                    result.durability + "_P" +
+                    to_string(result.producerCount) + "_C" +
+                    to_string(result.consumerCount) + "_R" +
+                    to_string(result.readerCount) + "_N" +
+                    to_string(result.operationCount) + ".json";
+  for (auto &c : fileName) {
+    if (c == ' ' || c == '/') {
+      c = '_';
+    }
+  }
+  TraceRecorder::exportChromeTrace(fileName);
 }
 
 //--
@@ -316,6 +516,7 @@ std::vector<BenchmarkTool::BenchmarkResult> BenchmarkTool::runCustomBenchmark(
 
         // Push result
         results.push_back(result);
+        exportTrace(result);
       }
     }
   }
@@ -330,6 +531,7 @@ void BenchmarkTool::collectCustomStatistics(
   result.tasksProduced =
       ProducerConsumerConcurrentIO::getGlobalTaskCounter() - 1;
   result.tasksConsumed = ioSystem.getTasksCompleted();
+  result.tasksDropped = ioSystem.getTasksDropped();
   result.tasksRead = ioSystem.isReadCompleted() ? result.tasksProduced : 0;
   result.maxQueueLength = ioSystem.getTaskQueue()->getMaxQueueLength();
 }
@@ -348,7 +550,7 @@ void BenchmarkTool::exportCustomResultsToCSV(
   file << "TestName,LockType,ProducerCount,ConsumerCount,ReaderCount,"
           "OperationCount,TotalTime(us),ProducerTime(us),ConsumerTime(us),"
           "ReaderTime(us),TasksProduced,TasksConsumed,TasksRead,"
-          "MaxQueueLength\n";
+          "MaxQueueLength,TasksDropped\n";
 
   // Export content
   for (const auto &result : results) {
@@ -358,8 +560,880 @@ void BenchmarkTool::exportCustomResultsToCSV(
          << result.totalTime << "," << result.producerRunningTime << ","
          << result.consumerRunningTime << "," << result.readerRunningTime << ","
          << result.tasksProduced << "," << result.tasksConsumed << ","
-         << result.tasksRead << "," << result.maxQueueLength << "\n";
+         << result.tasksRead << "," << result.maxQueueLength << ","
+         << result.tasksDropped << "\n";
+  }
+
+  file.close();
+}
+
+// Run the clock benchmark, each iteration takes a start/end pair of
+// timestamps the way TaskQueue::enqueue and CSVHandler::writeRow do
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runClockBenchmark(const vector<int> &callCounts) {
+  vector<MicroBenchmarkResult> results;
+
+  auto record = [&results](const string &variant, int callCount,
+                           chrono::steady_clock::duration elapsed) {
+    MicroBenchmarkResult result;
+    result.testName = "Clock Overhead";
+    result.variant = variant;
+    result.parameter = callCount;
+    result.operationCount = callCount;
+    result.totalTimeNs =
+        chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+    result.nsPerOperation =
+        static_cast<double>(result.totalTimeNs) / callCount;
+    results.push_back(result);
+  };
+
+  CycleClock::ticksPerNanosecond(); // keep calibration out of the timing
+
+  for (int callCount : callCounts) {
+    volatile long sink = 0; // keep the clock reads alive
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < callCount; ++i) {
+      auto begin = chrono::high_resolution_clock::now();
+      auto end = chrono::high_resolution_clock::now();
+      sink = sink + chrono::duration_cast<chrono::microseconds>(end - begin)
+                        .count();
+    }
+    record("high_resolution_clock", callCount,
+           chrono::steady_clock::now() - start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < callCount; ++i) {
+      uint64_t begin = CycleClock::now();
+      sink = sink + (CycleClock::now() - begin);
+    }
+    record(string("CycleClock(") + CycleClock::sourceName() + ")", callCount,
+           chrono::steady_clock::now() - start);
+  }
+
+  return results;
+}
+
+// Run the read benchmark: for every size and variant, fill a sample file,
+// read it once to warm the page cache and then once timed
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runReadBenchmark(const vector<long> &fileSizes) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_read.csv";
+
+  // owning rows (readAll), row views (readTable), streamed rows (forEachRow),
+  // id and status of completed rows (readTable with a query)
+  enum class Shape { Rows, Views, Streamed, Query };
+  CSVQuery completedQuery;
+  completedQuery.select({0, 2}).whereEquals(2, "Complete");
+  const vector<tuple<string, ReadMode, Shape>> variants = {
+      {"Stream", ReadMode::Stream, Shape::Rows},
+      {"Stream+Views", ReadMode::Stream, Shape::Views},
+      {"Mmap", ReadMode::Mmap, Shape::Rows},
+      {"Mmap+Views", ReadMode::Mmap, Shape::Views},
+      {"ForEachRow", ReadMode::Stream, Shape::Streamed},
+      {"Mmap+Query", ReadMode::Mmap, Shape::Query}};
+
+  for (long fileSize : fileSizes) {
+    for (const auto &[variant, mode, shape] : variants) {
+      // the handler starts from an empty file, fill it afterwards
+      CSVHandler csvHandler(filePath, LockType::RWLock);
+      long rowCount = writeSampleCSV(filePath, fileSize);
+      csvHandler.setReadMode(mode);
+      auto readRows = [&csvHandler, &completedQuery,
+                       shape = shape]() -> long {
+        switch (shape) {
+        case Shape::Rows:
+          return csvHandler.readAll().size();
+        case Shape::Views:
+          return csvHandler.readTable().rowCount();
+        case Shape::Query:
+          return csvHandler.readTable(completedQuery).rowCount();
+        default:
+          return csvHandler.forEachRow([](const CSVRow &) { return true; });
+        }
+      };
+      readRows(); // warm-up
+
+      auto start = chrono::steady_clock::now();
+      long rowsRead = readRows();
+      auto elapsed = chrono::steady_clock::now() - start;
+
+      // every other sample row is complete
+      long expectedRows = shape == Shape::Query ? (rowCount + 1) / 2 : rowCount;
+      if (rowsRead != expectedRows) {
+        cerr << "Read benchmark: expected " << expectedRows << " rows, got "
+             << rowsRead << endl;
+      }
+
+      MicroBenchmarkResult result;
+      result.testName = "Read All";
+      result.variant = variant;
+      result.parameter = fileSize;
+      result.operationCount = rowCount;
+      result.totalTimeNs =
+          chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+      result.nsPerOperation =
+          static_cast<double>(result.totalTimeNs) / rowCount;
+      result.throughput = result.totalTimeNs > 0
+                              ? fileSize * 1000.0 / result.totalTimeNs
+                              : 0; // MB/s
+      results.push_back(result);
+    }
   }
 
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the parser benchmark: tokenize a buffer of consumer-shaped rows, every
+// tenth name quoted with an embedded comma, once per kernel and size
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runParserBenchmark(const vector<long> &bufferSizes) {
+  vector<MicroBenchmarkResult> results;
+  const int rounds = 5; // best of, the buffer stays in cache for small sizes
+
+  for (long bufferSize : bufferSizes) {
+    string buffer;
+    buffer.reserve(bufferSize + 64);
+    for (long row = 0; static_cast<long>(buffer.size()) < bufferSize; ++row) {
+      buffer += to_string(row);
+      buffer += row % 10 == 0 ? ",\"Task, " + to_string(row) + "\""
+                              : ",Task " + to_string(row);
+      buffer += row % 2 == 0 ? ",Complete\n" : ",Pending\n";
+    }
+
+    for (CSVParser::Kernel kernel :
+         {CSVParser::Kernel::Scalar, CSVParser::Kernel::SSE2,
+          CSVParser::Kernel::AVX2}) {
+      if (!CSVParser::isSupported(kernel)) {
+        continue;
+      }
+      CSVParser::setKernel(kernel);
+
+      long bestNs = LONG_MAX;
+      size_t rowCount = 0;
+      for (int round = 0; round < rounds; ++round) {
+        ParsedRows rows;
+        rows.cells.reserve(buffer.size() / 8);
+        rows.rowStarts.reserve(buffer.size() / 24);
+        auto start = chrono::steady_clock::now();
+        CSVParser::parse(buffer.data(), buffer.size(), rows);
+        long elapsedNs = chrono::duration_cast<chrono::nanoseconds>(
+                             chrono::steady_clock::now() - start)
+                             .count();
+        bestNs = min(bestNs, elapsedNs);
+        rowCount = rows.rowStarts.size() - 1;
+      }
+
+      MicroBenchmarkResult result;
+      result.testName = "CSV Tokenizer";
+      result.variant = CSVParser::kernelName(kernel);
+      result.parameter = buffer.size();
+      result.operationCount = rowCount;
+      result.totalTimeNs = bestNs;
+      result.nsPerOperation = static_cast<double>(bestNs) / rowCount;
+      result.throughput =
+          bestNs > 0 ? static_cast<double>(buffer.size()) / bestNs : 0; // GB/s
+      results.push_back(result);
+    }
+  }
+
+  CSVParser::setKernel(CSVParser::Kernel::Auto);
+  return results;
+}
+
+// Run the parallel read benchmark: one sample file, every thread count reads
+// it once to warm up and then three times, the best time is kept
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runParallelReadBenchmark(long fileSize,
+                                        const vector<int> &threadCounts) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_parallel_read.csv";
+
+  // the handler starts from an empty file, fill it afterwards
+  CSVHandler csvHandler(filePath, LockType::RWLock);
+  long rowCount = writeSampleCSV(filePath, fileSize);
+  csvHandler.setReadMode(ReadMode::Mmap);
+
+  for (int threadCount : threadCounts) {
+    csvHandler.setReadThreads(threadCount);
+    csvHandler.readTable(); // warm-up
+
+    long bestNs = LONG_MAX;
+    for (int round = 0; round < 3; ++round) {
+      auto start = chrono::steady_clock::now();
+      long rowsRead = csvHandler.readTable().rowCount();
+      long elapsedNs = chrono::duration_cast<chrono::nanoseconds>(
+                           chrono::steady_clock::now() - start)
+                           .count();
+      bestNs = min(bestNs, elapsedNs);
+      if (rowsRead != rowCount) {
+        cerr << "Parallel read benchmark: expected " << rowCount
+             << " rows, got " << rowsRead << endl;
+      }
+    }
+
+    MicroBenchmarkResult result;
+    result.testName = "Parallel Read";
+    result.variant = to_string(threadCount) + " threads";
+    result.parameter = threadCount;
+    result.operationCount = rowCount;
+    result.totalTimeNs = bestNs;
+    result.nsPerOperation = static_cast<double>(bestNs) / rowCount;
+    result.throughput = bestNs > 0 ? fileSize * 1000.0 / bestNs : 0; // MB/s
+    results.push_back(result);
+  }
+
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the I/O backend benchmark: per directory, batch size and backend,
+// write batches of pre-formatted rows with writeFormatted, then read the
+// file once to warm the cache and once timed. A batch within one ring chunk
+// shows what io_uring costs when nothing can overlap.
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runIOBackendBenchmark(const vector<string> &directories,
+                                     long fileSize,
+                                     const vector<long> &batchSizes) {
+  vector<MicroBenchmarkResult> results;
+
+  auto record = [&results](const string &testName, const string &variant,
+                           long elapsedNs, long bytes, long batchSize,
+                           long operations) {
+    MicroBenchmarkResult result;
+    result.testName = testName;
+    result.variant = variant;
+    result.parameter = batchSize;
+    result.operationCount = operations;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / operations;
+    result.throughput = elapsedNs > 0 ? bytes * 1000.0 / elapsedNs : 0; // MB/s
+    result.bytes = bytes;
+    results.push_back(result);
+  };
+
+  for (long batchSize : batchSizes) {
+    // one batch of consumer-shaped rows, written repeatedly
+    string batch;
+    int batchRows = 0;
+    while (static_cast<long>(batch.size()) < batchSize) {
+      CSVHandler::formatRow(batch, {to_string(batchRows),
+                                    "Task_" + to_string(batchRows),
+                                    batchRows % 2 == 0 ? "Complete"
+                                                       : "Incomplete"});
+      batchRows++;
+    }
+    long batchCount = max(1L, fileSize / static_cast<long>(batch.size()));
+    long bytesWritten = batchCount * batch.size();
+
+    for (const string &directory : directories) {
+      const string filePath = directory + "/test_io_backend.csv";
+      for (IOBackend backend : {IOBackend::Sync, IOBackend::Uring}) {
+        string variant =
+            string(backend == IOBackend::Sync ? "Sync" : "Uring") + " " +
+            directory;
+        for (Durability durability :
+             {Durability::None, Durability::FDataSync}) {
+          CSVHandler csvHandler(filePath, LockType::Mutex);
+          csvHandler.setIOBackend(backend);
+          if (csvHandler.getIOBackend() != backend) {
+            break; // no io_uring here, nothing to compare
+          }
+          csvHandler.setDurability(durability);
+
+          auto start = chrono::steady_clock::now();
+          for (long i = 0; i < batchCount; ++i) {
+            csvHandler.writeFormatted(batch, batchRows);
+          }
+          long writeNs = chrono::duration_cast<chrono::nanoseconds>(
+                             chrono::steady_clock::now() - start)
+                             .count();
+          record("IO Backend Write " + durabilityName(durability), variant,
+                 writeNs, bytesWritten, batch.size(), batchCount);
+
+          if (durability != Durability::None) {
+            continue;
+          }
+          csvHandler.readTable(); // warm-up
+          start = chrono::steady_clock::now();
+          long rowsRead = csvHandler.readTable().rowCount();
+          long readNs = chrono::duration_cast<chrono::nanoseconds>(
+                            chrono::steady_clock::now() - start)
+                            .count();
+          if (rowsRead != batchCount * batchRows) {
+            cerr << "IO backend benchmark: expected " << batchCount * batchRows
+                 << " rows, got " << rowsRead << endl;
+          }
+          record("IO Backend Read", variant, readNs, bytesWritten,
+                 batch.size(), 1);
+        }
+      }
+      filesystem::remove(filePath);
+    }
+  }
+
+  return results;
+}
+
+// Run the O_DIRECT benchmark: the same batches through the page cache and
+// around it, then how much of the file the page cache holds afterwards
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runDirectIOBenchmark(const string &directory, long fileSize,
+                                    long batchSize) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = directory + "/test_direct_io.csv";
+
+  string batch;
+  int batchRows = 0;
+  while (static_cast<long>(batch.size()) < batchSize) {
+    CSVHandler::formatRow(batch, {to_string(batchRows),
+                                  "Task_" + to_string(batchRows),
+                                  batchRows % 2 == 0 ? "Complete"
+                                                     : "Incomplete"});
+    batchRows++;
+  }
+  long batchCount = max(1L, fileSize / static_cast<long>(batch.size()));
+  long bytesWritten = batchCount * batch.size();
+
+  for (IOBackend backend : {IOBackend::Sync, IOBackend::Direct}) {
+    string variant = backend == IOBackend::Sync ? "Buffered" : "Direct";
+    long writeNs = 0;
+    {
+      CSVHandler csvHandler(filePath, LockType::Mutex);
+      csvHandler.setIOBackend(backend);
+      if (csvHandler.getIOBackend() != backend) {
+        break; // O_DIRECT rejected here, nothing to compare
+      }
+      auto start = chrono::steady_clock::now();
+      for (long i = 0; i < batchCount; ++i) {
+        csvHandler.writeFormatted(batch, batchRows);
+      }
+      writeNs = chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start)
+                    .count();
+    } // closing writes the unaligned tail
+
+    MicroBenchmarkResult write;
+    write.testName = "Direct IO Write";
+    write.variant = variant;
+    write.parameter = bytesWritten;
+    write.operationCount = batchCount;
+    write.totalTimeNs = writeNs;
+    write.nsPerOperation = static_cast<double>(writeNs) / batchCount;
+    write.throughput = writeNs > 0 ? bytesWritten * 1000.0 / writeNs : 0;
+    write.bytes = bytesWritten;
+    results.push_back(write);
+
+    MicroBenchmarkResult cache;
+    cache.testName = "Direct IO Page Cache";
+    cache.variant = variant;
+    cache.parameter = bytesWritten;
+    cache.operationCount = 1;
+    cache.bytes = residentBytes(filePath);
+    cache.throughput = 100.0 * cache.bytes / bytesWritten; // % resident
+    results.push_back(cache);
+    filesystem::remove(filePath);
+  }
+
+  return results;
+}
+
+// Run the read isolation benchmark: readers loop over readTable until the
+// writer is done, writes are timed one by one
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runReadIsolationBenchmark(long rowCount, int readerCount) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_read_isolation.csv";
+
+  for (ReadIsolation isolation :
+       {ReadIsolation::Locked, ReadIsolation::Snapshot}) {
+    string variant = isolation == ReadIsolation::Locked ? "Locked" : "Snapshot";
+    CSVHandler csvHandler(filePath, LockType::RWLock);
+    csvHandler.setReadIsolation(isolation);
+    csvHandler.setFlushPolicy(FlushPolicy::EveryNRows, 100);
+
+    atomic<bool> writing{true};
+    atomic<long> reads{0};
+    vector<thread> readers;
+    for (int r = 0; r < readerCount; ++r) {
+      readers.emplace_back([&] {
+        while (writing.load()) {
+          csvHandler.readTable();
+          reads++;
+        }
+      });
+    }
+
+    long maxWriteNs = 0;
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < rowCount; ++i) {
+      auto writeStart = chrono::steady_clock::now();
+      csvHandler.writeRow(i, "Task", true);
+      maxWriteNs = max<long>(maxWriteNs,
+                             chrono::duration_cast<chrono::nanoseconds>(
+                                 chrono::steady_clock::now() - writeStart)
+                                 .count());
+    }
+    csvHandler.flush();
+    long elapsedNs = chrono::duration_cast<chrono::nanoseconds>(
+                         chrono::steady_clock::now() - start)
+                         .count();
+    writing = false;
+    for (auto &reader : readers) {
+      reader.join();
+    }
+
+    MicroBenchmarkResult writer;
+    writer.testName = "Read Isolation Writer";
+    writer.variant = variant;
+    writer.parameter = readerCount;
+    writer.operationCount = rowCount;
+    writer.totalTimeNs = elapsedNs;
+    writer.nsPerOperation = static_cast<double>(elapsedNs) / rowCount;
+    writer.throughput = elapsedNs > 0 ? rowCount * 1e9 / elapsedNs : 0;
+    writer.bytes = maxWriteNs; // worst single writeRow
+    results.push_back(writer);
+
+    MicroBenchmarkResult reader;
+    reader.testName = "Read Isolation Reader";
+    reader.variant = variant;
+    reader.parameter = readerCount;
+    reader.operationCount = reads.load();
+    reader.totalTimeNs = elapsedNs;
+    reader.nsPerOperation =
+        reads > 0 ? static_cast<double>(elapsedNs) / reads : 0;
+    reader.throughput = elapsedNs > 0 ? reads * 1e9 / elapsedNs : 0;
+    results.push_back(reader);
+  }
+
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the shard benchmark: the same rows written by threadCount threads
+// into one locked file and into per-thread shards, then the shards are
+// compacted into one CSV by task id
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runShardBenchmark(const vector<int> &threadCounts,
+                                 long rowsPerThread) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_shards.csv";
+  const string compactPath = "test_shards_compact.csv";
+
+  auto record = [&results](const string &variant, int threadCount,
+                           long rows, long elapsedNs) {
+    MicroBenchmarkResult result;
+    result.testName = "Shard Write";
+    result.variant = variant;
+    result.parameter = threadCount;
+    result.operationCount = rows;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / rows;
+    result.throughput = elapsedNs > 0 ? rows * 1e9 / elapsedNs : 0; // rows/s
+    results.push_back(result);
+  };
+  // run writeRow(thread, id) on threadCount threads, return the wall time
+  auto timeWriters = [rowsPerThread](int threadCount,
+                                     const function<void(long)> &writeRow) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> writers;
+    for (int t = 0; t < threadCount; ++t) {
+      writers.emplace_back([&writeRow, t, threadCount, rowsPerThread] {
+        for (long i = 0; i < rowsPerThread; ++i) {
+          writeRow(i * threadCount + t);
+        }
+      });
+    }
+    for (auto &writer : writers) {
+      writer.join();
+    }
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto taskRow = [](long id) -> vector<string> {
+    return {to_string(id), "Task_" + to_string(id), "Complete"};
+  };
+
+  for (int threadCount : threadCounts) {
+    long rows = rowsPerThread * threadCount;
+    {
+      CSVHandler csvHandler(filePath, LockType::Mutex);
+      csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 1 << 16);
+      long elapsedNs = timeWriters(threadCount, [&](long id) {
+        csvHandler.writeRow(taskRow(id));
+      });
+      csvHandler.flush();
+      record("Shared file", threadCount, rows, elapsedNs);
+    }
+    {
+      ShardedCSVWriter shardedWriter(filePath);
+      long elapsedNs = timeWriters(threadCount, [&](long id) {
+        shardedWriter.writeRow(taskRow(id));
+      });
+      shardedWriter.flush();
+      record("Sharded", threadCount, rows, elapsedNs);
+
+      CSVHandler compacted(compactPath, LockType::Mutex);
+      auto start = chrono::steady_clock::now();
+      long merged = shardedWriter.compact(compacted);
+      record("Sharded compaction", threadCount, rows,
+             chrono::duration_cast<chrono::nanoseconds>(
+                 chrono::steady_clock::now() - start)
+                 .count());
+      if (merged != rows) {
+        cerr << "Shard benchmark: compacted " << merged << " of " << rows
+             << " rows" << endl;
+      }
+      shardedWriter.removeShards();
+    }
+  }
+
+  filesystem::remove(filePath);
+  filesystem::remove(compactPath);
+  return results;
+}
+
+// Run the append benchmark: rowCount rows through a growing file and
+// through the preallocated mapping, then read back
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runAppendBenchmark(const vector<long> &rowCounts) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_append.csv";
+
+  auto record = [&results](const string &testName, const string &variant,
+                           long rowCount, long elapsedNs, long fileBytes) {
+    MicroBenchmarkResult result;
+    result.testName = testName;
+    result.variant = variant;
+    result.parameter = rowCount;
+    result.operationCount = rowCount;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / rowCount;
+    result.throughput =
+        elapsedNs > 0 ? rowCount * 1e9 / elapsedNs : 0; // rows/s
+    result.bytes = fileBytes;
+    results.push_back(result);
+  };
+  auto elapsedSince = [](chrono::steady_clock::time_point start) {
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto taskRow = [](long id) -> vector<string> {
+    return {to_string(id), "Task_" + to_string(id),
+            id % 2 == 0 ? "Complete" : "Incomplete"};
+  };
+
+  for (long rowCount : rowCounts) {
+    for (FlushPolicy policy : {FlushPolicy::PerRow, FlushPolicy::EveryNBytes}) {
+      string variant =
+          policy == FlushPolicy::PerRow ? "CSVHandler per row"
+                                        : "CSVHandler 64KB buffer";
+      CSVHandler csvHandler(filePath, LockType::Mutex);
+      csvHandler.setFlushPolicy(policy, 1 << 16);
+      auto start = chrono::steady_clock::now();
+      for (long i = 0; i < rowCount; ++i) {
+        csvHandler.writeRow(taskRow(i));
+      }
+      csvHandler.flush();
+      record("Append Write", variant, rowCount, elapsedSince(start),
+             filesystem::file_size(filePath));
+
+      start = chrono::steady_clock::now();
+      long rowsRead = csvHandler.readTable().rowCount();
+      record("Append Read", variant, rowCount, elapsedSince(start),
+             filesystem::file_size(filePath));
+      if (rowsRead != rowCount) {
+        cerr << "Append benchmark: " << variant << " read " << rowsRead
+             << " of " << rowCount << " rows" << endl;
+      }
+    }
+
+    MappedCSVWriter mappedWriter(filePath);
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < rowCount; ++i) {
+      mappedWriter.writeRow(taskRow(i));
+    }
+    record("Append Write", "Mapped (" +
+               to_string(mappedWriter.getExtentCount()) + " extents)",
+           rowCount, elapsedSince(start), mappedWriter.getCommittedLength());
+
+    start = chrono::steady_clock::now();
+    long rowsRead = mappedWriter.readTable().rowCount();
+    record("Append Read", "Mapped", rowCount, elapsedSince(start),
+           mappedWriter.getCommittedLength());
+    if (rowsRead != rowCount) {
+      cerr << "Append benchmark: mapped read " << rowsRead << " of "
+           << rowCount << " rows" << endl;
+    }
+    // the truncation back to the committed length is part of the cost
+    start = chrono::steady_clock::now();
+    mappedWriter.close();
+    record("Append Close", "Mapped", rowCount, elapsedSince(start),
+           filesystem::file_size(filePath));
+  }
+
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the row writer benchmark: the consumer's row (id, name, status)
+// written rowCount times through each API after a warm-up that grows the
+// reused buffers; allocations are counted by AllocationCounter
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runRowWriterBenchmark(long rowCount) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_row_writer.csv";
+  const string name = "Task_name_longer_than_sso"; // heap-backed when copied
+  const long warmupRows = 1000;
+
+  // time rowCount calls of writeRow(id) after warmupRows untimed ones
+  auto measure = [&](const string &testName, const string &variant,
+                     const function<void(int)> &writeRow) {
+    for (long i = 0; i < warmupRows; ++i) {
+      writeRow(i);
+    }
+    AllocationCounter::setEnabled(true);
+    AllocationCounter::reset();
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < rowCount; ++i) {
+      writeRow(i);
+    }
+    long elapsedNs = chrono::duration_cast<chrono::nanoseconds>(
+                         chrono::steady_clock::now() - start)
+                         .count();
+    AllocationCounter::setEnabled(false);
+    MicroBenchmarkResult result;
+    result.testName = testName;
+    result.variant = variant;
+    result.parameter = rowCount;
+    result.operationCount = rowCount;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / rowCount;
+    result.throughput = elapsedNs > 0 ? rowCount * 1e9 / elapsedNs : 0;
+    result.allocations = AllocationCounter::getCount();
+    results.push_back(result);
+  };
+
+  {
+    string out;
+    measure("Row Format", "vector<string>", [&](int id) {
+      out.clear();
+      CSVHandler::formatRow(
+          out, {to_string(id), name, id % 2 == 0 ? "Complete" : "Incomplete"});
+    });
+    measure("Row Format", "Typed", [&](int id) {
+      out.clear();
+      CSVHandler::formatRow(out, id, name, id % 2 == 0);
+    });
+  }
+  {
+    CSVHandler csvHandler(filePath, LockType::Mutex);
+    csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 1 << 16);
+    measure("Row Write CSVHandler", "vector<string>", [&](int id) {
+      csvHandler.writeRow(
+          {to_string(id), name, id % 2 == 0 ? "Complete" : "Incomplete"});
+    });
+    measure("Row Write CSVHandler", "Typed", [&](int id) {
+      csvHandler.writeRow(id, name, id % 2 == 0);
+    });
+  }
+  {
+    // the background writer allocates too, per batch rather than per row
+    CSVHandler csvHandler(filePath, LockType::Mutex);
+    AsyncCSVWriter asyncWriter(csvHandler);
+    measure("Row Write AsyncCSVWriter", "vector<string>", [&](int id) {
+      asyncWriter.writeRow(
+          {to_string(id), name, id % 2 == 0 ? "Complete" : "Incomplete"});
+    });
+    measure("Row Write AsyncCSVWriter", "Typed", [&](int id) {
+      asyncWriter.writeRow(id, name, id % 2 == 0);
+    });
+  }
+
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the allocator benchmark: each variant builds its resource, does the
+// work and releases everything before the counters are read
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runAllocatorBenchmark(long rowCount, int taskCount) {
+  vector<MicroBenchmarkResult> results;
+  const string filePath = "test_allocator.csv";
+
+  // run work once, record time, operator new calls and peak heap growth
+  auto measure = [&results](const string &testName, const string &variant,
+                            long operations, const function<void()> &work) {
+    AllocationCounter::setEnabled(true);
+    AllocationCounter::reset();
+    long liveBefore = AllocationCounter::getLiveBytes();
+    auto start = chrono::steady_clock::now();
+    work();
+    long elapsedNs = chrono::duration_cast<chrono::nanoseconds>(
+                         chrono::steady_clock::now() - start)
+                         .count();
+    AllocationCounter::setEnabled(false);
+    MicroBenchmarkResult result;
+    result.testName = testName;
+    result.variant = variant;
+    result.parameter = operations;
+    result.operationCount = operations;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / operations;
+    result.throughput = elapsedNs > 0 ? operations * 1e9 / elapsedNs : 0;
+    result.bytes = AllocationCounter::getPeakBytes() - liveBefore;
+    result.allocations = AllocationCounter::getCount();
+    results.push_back(result);
+  };
+
+  CSVHandler csvHandler(filePath, LockType::Mutex);
+  long rows = writeSampleCSV(filePath, rowCount * 24); // ~24 bytes per row
+  measure("Allocator readAll", "Global", rows, [&] {
+    auto data = csvHandler.readAll();
+  });
+  measure("Allocator readAll", "Monotonic", rows, [&] {
+    pmr::monotonic_buffer_resource arena;
+    auto data = csvHandler.readAll(&arena);
+  }); // the arena frees every row in one go
+  measure("Allocator readAll", "Pool", rows, [&] {
+    pmr::unsynchronized_pool_resource pool;
+    auto data = csvHandler.readAll(&pool);
+  });
+
+  // producer-shaped tasks through the queue, then drained
+  auto runQueue = [taskCount](pmr::memory_resource *resource) {
+    TaskQueue taskQueue(LockType::Mutex, nullptr, resource);
+    for (int i = 0; i < taskCount; ++i) {
+      taskQueue.enqueue(Task{i, "Task_" + to_string(i), false});
+    }
+    Task task;
+    for (int i = 0; i < taskCount; ++i) {
+      taskQueue.dequeue(task);
+    }
+  };
+  measure("Allocator TaskQueue", "Global", taskCount,
+          [&] { runQueue(pmr::get_default_resource()); });
+  measure("Allocator TaskQueue", "Monotonic", taskCount, [&] {
+    pmr::monotonic_buffer_resource arena;
+    runQueue(&arena);
+  });
+  measure("Allocator TaskQueue", "Pool", taskCount, [&] {
+    pmr::unsynchronized_pool_resource pool;
+    runQueue(&pool);
+  });
+
+  filesystem::remove(filePath);
+  return results;
+}
+
+// Run the format benchmark: write rowCount task records through each
+// handler, flush, then read them all back; both phases are timed
+vector<BenchmarkTool::MicroBenchmarkResult>
+BenchmarkTool::runFormatBenchmark(const vector<long> &rowCounts) {
+  vector<MicroBenchmarkResult> results;
+  const string csvPath = "test_format.csv";
+  const string binaryPath = "test_format.log";
+  const vector<string> statuses = {"Complete", "Incomplete"};
+
+  auto record = [&results](const string &variant, const string &phase,
+                           long rowCount, long elapsedNs, long fileBytes) {
+    MicroBenchmarkResult result;
+    result.testName = "Format " + phase;
+    result.variant = variant;
+    result.parameter = rowCount;
+    result.operationCount = rowCount;
+    result.totalTimeNs = elapsedNs;
+    result.nsPerOperation = static_cast<double>(elapsedNs) / rowCount;
+    result.throughput =
+        elapsedNs > 0 ? rowCount * 1e9 / elapsedNs : 0; // rows/s
+    result.bytes = fileBytes;
+    results.push_back(result);
+  };
+  auto elapsedSince = [](chrono::steady_clock::time_point start) -> long {
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  // task names are unique in the consumers' output; the repeated set shows
+  // what the name dictionary saves
+  const vector<pair<string, long>> nameSets = {{"", 0}, {" (100 names)", 100}};
+
+  for (long rowCount : rowCounts) {
+    for (const auto &[suffix, distinctNames] : nameSets) {
+      auto taskName = [distinctNames = distinctNames](long i) {
+        return "Task_" + to_string(distinctNames > 0 ? i % distinctNames : i);
+      };
+      {
+        CSVHandler csvHandler(csvPath, LockType::Mutex);
+        csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 1 << 16);
+        auto start = chrono::steady_clock::now();
+        for (long i = 0; i < rowCount; ++i) {
+          csvHandler.writeRow({to_string(i), taskName(i), statuses[i % 2]});
+        }
+        csvHandler.flush();
+        long writeNs = elapsedSince(start);
+        long fileBytes = filesystem::file_size(csvPath);
+        record("CSV" + suffix, "Write", rowCount, writeNs, fileBytes);
+
+        start = chrono::steady_clock::now();
+        long rowsRead = csvHandler.readAll().size();
+        record("CSV" + suffix, "Read", rowCount, elapsedSince(start),
+               fileBytes);
+        if (rowsRead != rowCount) {
+          cerr << "Format benchmark: CSV read " << rowsRead << " of "
+               << rowCount << " rows" << endl;
+        }
+      }
+      {
+        BinaryLogHandler binaryLog(binaryPath, LockType::Mutex);
+        auto start = chrono::steady_clock::now();
+        for (long i = 0; i < rowCount; ++i) {
+          binaryLog.writeRecord(i, taskName(i), statuses[i % 2]);
+        }
+        binaryLog.flush();
+        long writeNs = elapsedSince(start);
+        long fileBytes = filesystem::file_size(binaryPath);
+        record("Binary" + suffix, "Write", rowCount, writeNs, fileBytes);
+
+        start = chrono::steady_clock::now();
+        long rowsRead = binaryLog.readAll().size();
+        record("Binary" + suffix, "Read", rowCount, elapsedSince(start),
+               fileBytes);
+        if (rowsRead != rowCount) {
+          cerr << "Format benchmark: binary log read " << rowsRead << " of "
+               << rowCount << " rows" << endl;
+        }
+      }
+    }
+  }
+
+  filesystem::remove(csvPath);
+  filesystem::remove(binaryPath);
+  return results;
+}
+
+// Export micro benchmark results to CSV
+void BenchmarkTool::exportMicroResultsToCSV(
+    const string &filePath, const vector<MicroBenchmarkResult> &results) {
+  ofstream file(filePath);
+  if (!file.is_open()) {
+    cerr << "Failed to open CSV file for writing: " << filePath << endl;
+    return;
+  }
+
+  file << "TestName,Variant,Parameter,OperationCount,TotalTime(ns),"
+          "NsPerOperation,Throughput,Bytes,Allocations\n";
+  for (const auto &result : results) {
+    file << result.testName << "," << result.variant << ","
+         << result.parameter << "," << result.operationCount << ","
+         << result.totalTimeNs << "," << result.nsPerOperation << ","
+         << result.throughput << "," << result.bytes << ","
+         << result.allocations << "\n";
+  }
   file.close();
 }
@@ -2,7 +2,9 @@
 #ifndef BENCHMARK_TOOL_H
 #define BENCHMARK_TOOL_H
 
+#include "../cpp/BinaryLogHandler.h"
 #include "../cpp/CSVHandler.h"
+#include "../cpp/ShardedCSVWriter.h"
 #include "../cpp/ProducerConsumerConcurrentIO.h"
 #include "../cpp/TaskQueue.h"
 #include <functional>
@@ -43,10 +45,33 @@ public:
     int tasksProduced = 0;
     int tasksConsumed = 0;
     int tasksRead = 0;
+    int tasksDropped = 0; // rows a DropNewest writer discarded
     long totalIOWriteTime = 0;
     long totalWriteTime = 0;
     long totalReadTime = 0;
     int maxQueueLength = 0;
+
+    // CSV group commit statistics
+    std::string durability = "None";
+    double avgBatchSize = 0;   // rows per committed batch
+    long syncCount = 0;        // number of fdatasync calls
+    long syncP50Time = 0;      // fdatasync latency percentiles (us)
+    long syncP99Time = 0;
+    std::string batchSizeHistogram;   // "<=bound:count ..." buckets
+    std::string syncLatencyHistogram; // buckets in us
+  };
+
+  // Result of a single-threaded micro benchmark (clock source, parser...)
+  struct MicroBenchmarkResult {
+    std::string testName;
+    std::string variant;     // implementation being measured
+    long parameter = 0;      // test-specific size (bytes, threads, ...)
+    long operationCount = 0; // operations timed
+    long totalTimeNs = 0;    // wall time for all operations
+    double nsPerOperation = 0;
+    double throughput = 0; // test-specific rate (e.g. MB/s), 0 if unused
+    long bytes = 0;        // bytes produced or consumed, 0 if unused
+    long allocations = 0;  // global operator new calls, 0 if unused
   };
 
   static std::mutex statsMutex;
@@ -72,6 +97,14 @@ public:
                  const std::vector<int> &operationCounts,
                  void (*ioTestFunc)(CSVHandler &, int, int, int));
 
+  // Group commit sweep: writerCount threads of rowsPerWriter writeRow calls
+  // per lock type ("AtomicAppend" for lock-free appends) and durability
+  static std::vector<BenchmarkResult>
+  runDurabilityBenchmark(const std::vector<std::string> &lockTypes,
+                         const std::vector<Durability> &durabilities,
+                         const std::vector<int> &writerCounts,
+                         int rowsPerWriter);
+
   // Run a custom benchmark with corrected signature
   static std::vector<BenchmarkResult> runCustomBenchmark(
       const std::string &testName, const std::vector<std::string> &lockTypes,
@@ -80,6 +113,76 @@ public:
       void (*customTestFunc)(const std::string &, std::shared_ptr<TaskQueue>,
                              int, int, int, int));
 
+  // Compare timestamp sources used by the hot-path instrumentation
+  static std::vector<MicroBenchmarkResult>
+  runClockBenchmark(const std::vector<int> &callCounts);
+
+  // Compare read modes (stream vs mmap) and result shapes (readAll,
+  // readTable views, forEachRow streaming, filtered readTable) across file
+  // sizes in bytes
+  static std::vector<MicroBenchmarkResult>
+  runReadBenchmark(const std::vector<long> &fileSizes);
+
+  // Tokenizer throughput (GB/s) of every supported CSVParser kernel over
+  // in-memory buffers of the given sizes in bytes
+  static std::vector<MicroBenchmarkResult>
+  runParserBenchmark(const std::vector<long> &bufferSizes);
+
+  // Parallel readTable (mmap) of one file with each thread count; the first
+  // thread count is the baseline the speedup is reported against
+  static std::vector<MicroBenchmarkResult>
+  runParallelReadBenchmark(long fileSize, const std::vector<int> &threadCounts);
+
+  // Synchronous vs io_uring I/O in each directory (e.g. a tmpfs and a disk):
+  // fileSize bytes written in batches of each size (with and without
+  // fdatasync), then read back with readTable
+  static std::vector<MicroBenchmarkResult>
+  runIOBackendBenchmark(const std::vector<std::string> &directories,
+                        long fileSize, const std::vector<long> &batchSizes);
+
+  // Buffered vs O_DIRECT writes of fileSize bytes in batchSize batches into
+  // directory: MB/s, then the page cache share of the file (throughput is
+  // the resident percentage, bytes the resident bytes)
+  static std::vector<MicroBenchmarkResult>
+  runDirectIOBenchmark(const std::string &directory, long fileSize,
+                       long batchSize);
+
+  // One writer appending rowCount rows while readerCount threads re-read
+  // the whole file, under the RWLock with Locked vs Snapshot isolation:
+  // writer rows/s and worst write latency (bytes, in ns), reader reads/s
+  static std::vector<MicroBenchmarkResult>
+  runReadIsolationBenchmark(long rowCount, int readerCount);
+
+  // Writer scaling: rowsPerThread rows from each of threadCount threads into
+  // one shared CSVHandler vs one ShardedCSVWriter shard per thread (plus
+  // the compaction of the shards into one CSV), rows/s per thread count
+  static std::vector<MicroBenchmarkResult>
+  runShardBenchmark(const std::vector<int> &threadCounts, long rowsPerThread);
+
+  // Appends that grow the file (CSVHandler per row and 64 KB buffered) vs
+  // MappedCSVWriter's preallocated mapping: rows/s for rowCount rows, and
+  // the read of the committed rows back
+  static std::vector<MicroBenchmarkResult>
+  runAppendBenchmark(const std::vector<long> &rowCounts);
+
+  // Row writing through vector<string> vs the typed writeRow(id, name,
+  // done), formatting only and through CSVHandler/AsyncCSVWriter: ns and
+  // heap allocations per row (allocations is the total for rowCount rows)
+  static std::vector<MicroBenchmarkResult>
+  runRowWriterBenchmark(long rowCount);
+
+  // Global allocator vs std::pmr resources: readAll of rowCount rows and
+  // taskCount tasks through a TaskQueue, each with the default heap, a
+  // monotonic buffer and a pool. allocations counts operator new calls,
+  // bytes is the peak heap growth while the variant ran
+  static std::vector<MicroBenchmarkResult>
+  runAllocatorBenchmark(long rowCount, int taskCount);
+
+  // CSV vs binary log: write and read the same task records, rows/s and
+  // file size, for each row count
+  static std::vector<MicroBenchmarkResult>
+  runFormatBenchmark(const std::vector<long> &rowCounts);
+
   // Export results to CSV
   static void
   exportThreadResultsToCSV(const std::string &filePath,
@@ -87,8 +190,14 @@ public:
   static void exportIOResultsToCSV(const std::string &filePath,
                                    const std::vector<BenchmarkResult> &results);
   static void
+  exportDurabilityResultsToCSV(const std::string &filePath,
+                               const std::vector<BenchmarkResult> &results);
+  static void
   exportCustomResultsToCSV(const std::string &filePath,
                            const std::vector<BenchmarkResult> &results);
+  static void
+  exportMicroResultsToCSV(const std::string &filePath,
+                          const std::vector<MicroBenchmarkResult> &results);
 
   // Collect statistics
   static void collectThreadStatistics(TaskQueue &taskQueue,
@@ -97,6 +206,9 @@ public:
                                   BenchmarkResult &result);
   static void collectCustomStatistics(ProducerConsumerConcurrentIO &ioSystem,
                                       BenchmarkResult &result);
+
+  // Flush TraceRecorder events of one run to a Chrome trace JSON file
+  static void exportTrace(const BenchmarkResult &result);
 };
 
 #endif // BENCHMARK_TOOL_H
\ No newline at end of file
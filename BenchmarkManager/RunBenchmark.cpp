@@ -1,5 +1,8 @@
 // main.cpp
+#include "../cpp/util/LockProfiler.h"
+#include "../cpp/util/TraceRecorder.h"
 #include "BenchmarkTool.h"
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <thread>
@@ -138,8 +141,10 @@ void ioTestFunc(CSVHandler &csvHandler, int writerCount, int readerCount,
   vector<thread> readers;
   for (int i = 0; i < readerCount; ++i) {
     readers.emplace_back([&csvHandler, i]() {
-      auto rows = csvHandler.readAll();
-      cout << "Reader_" << i << " read " << rows.size() << " rows." << endl;
+      // readers share one parse of the file through the snapshot cache
+      auto snapshot = csvHandler.getSnapshot();
+      cout << "Reader_" << i << " read " << snapshot->rowCount() << " rows."
+           << endl;
     });
   }
 
@@ -168,6 +173,22 @@ void runIOBenchmark() {
   BenchmarkTool::exportIOResultsToCSV("ResultIO.csv", ioResults);
 }
 
+// Group commit: rows per batch and fdatasync latency per durability, with
+// lock-free O_APPEND writers for comparison
+void runDurabilityBenchmark() {
+  vector<string> lockTypes = {"MutexLock", "AtomicAppend"};
+  vector<Durability> durabilities = {Durability::None, Durability::Flush,
+                                     Durability::FDataSync};
+  vector<int> writerCounts = {1, 4, 8};
+
+  cout << "Running Durability Benchmark...\n" << endl;
+  auto durabilityResults = BenchmarkTool::runDurabilityBenchmark(
+      lockTypes, durabilities, writerCounts, 500);
+
+  BenchmarkTool::exportDurabilityResultsToCSV("ResultDurability.csv",
+                                              durabilityResults);
+}
+
 // -------------------------------------------------------------------
 // Custom benchmark test function and runCustomBenchmark--------------
 void customTestFunc(const std::string &lockType,          // 锁类型
@@ -232,26 +253,307 @@ void runCustomBenchmark() {
   BenchmarkTool::exportCustomResultsToCSV("ResultsCustom.csv", customResults);
 }
 
+// -------------------------------------------------------------------
+// Clock overhead benchmark, timestamp source of the instrumentation
+void runClockBenchmark() {
+  vector<int> callCounts = {1000, 100000, 1000000};
+
+  cout << "Running Clock Benchmark...\n" << endl;
+  auto clockResults = BenchmarkTool::runClockBenchmark(callCounts);
+  for (const auto &result : clockResults) {
+    cout << result.variant << ": " << result.nsPerOperation
+         << " ns per start/end pair (" << result.operationCount << " calls)"
+         << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultClock.csv", clockResults);
+}
+
+// -------------------------------------------------------------------
+// Read path benchmark: stream vs mmap, owning rows vs row views
+void runReadBenchmark() {
+  // 16 KB .. 256 MB; all variants but ForEachRow hold the whole file in
+  // memory, so larger files are bounded by memory rather than the read path
+  vector<long> fileSizes = {16L << 10, 1L << 20, 16L << 20, 256L << 20};
+
+  cout << "Running Read Benchmark...\n" << endl;
+  auto readResults = BenchmarkTool::runReadBenchmark(fileSizes);
+  for (const auto &result : readResults) {
+    cout << result.variant << " " << result.parameter
+         << " bytes: " << result.throughput << " MB/s ("
+         << result.operationCount << " rows)" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultRead.csv", readResults);
+}
+
+// -------------------------------------------------------------------
+// Tokenizer benchmark, scalar vs SIMD delimiter classification
+void runParserBenchmark() {
+  vector<long> bufferSizes = {64L << 10, 4L << 20, 64L << 20};
+
+  cout << "Running Parser Benchmark...\n" << endl;
+  auto parserResults = BenchmarkTool::runParserBenchmark(bufferSizes);
+  for (const auto &result : parserResults) {
+    cout << result.variant << " " << result.parameter
+         << " bytes: " << result.throughput << " GB/s" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultParser.csv", parserResults);
+}
+
+// -------------------------------------------------------------------
+// Parallel parse benchmark, speedup of one large read vs thread count
+void runParallelReadBenchmark() {
+  long fileSize = 256L << 20;
+  vector<int> threadCounts = {1, 2, 4, 8};
+
+  cout << "Running Parallel Read Benchmark...\n" << endl;
+  auto parallelResults =
+      BenchmarkTool::runParallelReadBenchmark(fileSize, threadCounts);
+  for (const auto &result : parallelResults) {
+    cout << result.variant << ": " << result.throughput << " MB/s, speedup "
+         << static_cast<double>(parallelResults.front().totalTimeNs) /
+                result.totalTimeNs
+         << "x" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultParallelRead.csv",
+                                         parallelResults);
+}
+
+// Synchronous vs io_uring writes and reads on a tmpfs and on the disk
+void runIOBackendBenchmark() {
+  vector<string> directories = {"/dev/shm", "."};
+  if (!filesystem::is_directory("/dev/shm")) {
+    directories.erase(directories.begin());
+  }
+
+  cout << "Running IO Backend Benchmark...\n" << endl;
+  // 4 KB batches fit one ring chunk, 1 MB batches span four
+  auto backendResults = BenchmarkTool::runIOBackendBenchmark(
+      directories, 64L << 20, {4L << 10, 1L << 20});
+  for (const auto &result : backendResults) {
+    cout << result.testName << " " << result.variant << " "
+         << result.parameter << " B batches: " << result.throughput << " MB/s"
+         << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultIOBackend.csv",
+                                         backendResults);
+}
+
+// Buffered vs O_DIRECT writes on the disk, MB/s and page cache footprint
+void runDirectIOBenchmark() {
+  cout << "Running Direct IO Benchmark...\n" << endl;
+  auto directResults =
+      BenchmarkTool::runDirectIOBenchmark(".", 256L << 20, 1L << 20);
+  for (const auto &result : directResults) {
+    if (result.testName == "Direct IO Write") {
+      cout << result.testName << " " << result.variant << ": "
+           << result.throughput << " MB/s" << endl;
+    } else {
+      cout << result.testName << " " << result.variant << ": "
+           << result.bytes << " bytes (" << result.throughput << "%)"
+           << endl;
+    }
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultDirectIO.csv", directResults);
+}
+
+// Locked vs snapshot-isolated readers next to one writer
+void runReadIsolationBenchmark() {
+  cout << "Running Read Isolation Benchmark...\n" << endl;
+  auto isolationResults = BenchmarkTool::runReadIsolationBenchmark(200000, 2);
+  for (const auto &result : isolationResults) {
+    cout << result.testName << " " << result.variant << ": "
+         << result.throughput << " ops/s";
+    if (result.bytes > 0) {
+      cout << ", worst write " << result.bytes << " ns";
+    }
+    cout << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultReadIsolation.csv",
+                                         isolationResults);
+}
+
+// Shared file vs per-thread shards, writer throughput by thread count
+void runShardBenchmark() {
+  vector<int> threadCounts = {1, 2, 4, 8};
+
+  cout << "Running Shard Benchmark...\n" << endl;
+  auto shardResults = BenchmarkTool::runShardBenchmark(threadCounts, 200000);
+  for (const auto &result : shardResults) {
+    cout << result.variant << " (" << result.parameter
+         << " threads): " << result.throughput << " rows/s" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultShard.csv", shardResults);
+}
+
+// Growing file vs preallocated mapping, append and read rows/s
+void runAppendBenchmark() {
+  vector<long> rowCounts = {10000, 100000, 1000000};
+
+  cout << "Running Append Benchmark...\n" << endl;
+  auto appendResults = BenchmarkTool::runAppendBenchmark(rowCounts);
+  for (const auto &result : appendResults) {
+    cout << result.testName << " " << result.variant << " ("
+         << result.parameter << " rows): " << result.throughput << " rows/s"
+         << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultAppend.csv", appendResults);
+}
+
+// vector<string> vs typed rows, ns and heap allocations per row
+void runRowWriterBenchmark() {
+  cout << "Running Row Writer Benchmark...\n" << endl;
+  auto rowResults = BenchmarkTool::runRowWriterBenchmark(1000000);
+  for (const auto &result : rowResults) {
+    cout << result.testName << " " << result.variant << ": "
+         << result.nsPerOperation << " ns/row, "
+         << static_cast<double>(result.allocations) / result.operationCount
+         << " allocations/row" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultRowWriter.csv", rowResults);
+}
+
+// Global allocator vs pmr resources, operator new calls and peak heap
+void runAllocatorBenchmark() {
+  cout << "Running Allocator Benchmark...\n" << endl;
+  auto allocatorResults = BenchmarkTool::runAllocatorBenchmark(1000000, 10000);
+  for (const auto &result : allocatorResults) {
+    cout << result.testName << " " << result.variant << ": "
+         << result.nsPerOperation << " ns/op, " << result.allocations
+         << " allocations, peak " << result.bytes << " bytes" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultAllocator.csv",
+                                         allocatorResults);
+}
+
+// CSV vs binary log, write and read rows/s and file size
+void runFormatBenchmark() {
+  vector<long> rowCounts = {10000, 100000, 1000000};
+
+  cout << "Running Format Benchmark...\n" << endl;
+  auto formatResults = BenchmarkTool::runFormatBenchmark(rowCounts);
+  for (const auto &result : formatResults) {
+    cout << result.testName << " " << result.variant << " ("
+         << result.parameter << " rows): " << result.throughput
+         << " rows/s, " << result.bytes << " bytes" << endl;
+  }
+
+  BenchmarkTool::exportMicroResultsToCSV("ResultFormat.csv", formatResults);
+}
+
+// opt-in benchmarks, selected by name with --micro=<name>[,<name>...]
+const vector<pair<string, void (*)()>> microBenchmarks = {
+    {"clock", runClockBenchmark},
+    {"read", runReadBenchmark},
+    {"parser", runParserBenchmark},
+    {"parallel-read", runParallelReadBenchmark},
+    {"format", runFormatBenchmark},
+    {"row-writer", runRowWriterBenchmark},
+    {"allocator", runAllocatorBenchmark},
+    {"io-backend", runIOBackendBenchmark},
+    {"direct-io", runDirectIOBenchmark},
+    {"shard", runShardBenchmark},
+    {"read-isolation", runReadIsolationBenchmark},
+    {"append", runAppendBenchmark},
+    {"durability", runDurabilityBenchmark},
+};
+
+// add the benchmarks named in a comma-separated list, false on an unknown
+// name
+bool selectMicroBenchmarks(const string &names, vector<bool> &selected) {
+  size_t begin = 0;
+  while (begin <= names.size()) {
+    size_t end = names.find(',', begin);
+    if (end == string::npos) {
+      end = names.size();
+    }
+    string name = names.substr(begin, end - begin);
+    size_t i = 0;
+    while (i < microBenchmarks.size() && microBenchmarks[i].first != name) {
+      ++i;
+    }
+    if (i == microBenchmarks.size()) {
+      cerr << "Unknown benchmark: " << name << ", expected one of:";
+      for (const auto &benchmark : microBenchmarks) {
+        cerr << " " << benchmark.first;
+      }
+      cerr << endl;
+      return false;
+    }
+    selected[i] = true;
+    begin = end + 1;
+  }
+  return true;
+}
+
 //--
 // main function-----------------------------------------------------
-int main() {
+// usage: RunBenchmark [--lock-profile] [--trace] [--micro[=<names>]]
+//   --lock-profile    record per-call-site lock contention, report at the end
+//   --trace           write a Chrome/Perfetto trace JSON after every run
+//   --micro           run every benchmark of microBenchmarks instead of the
+//                     thread, IO and custom benchmarks
+//   --micro=<names>   only the named ones, e.g. --micro=parser,durability
+int main(int argc, char *argv[]) {
+  vector<bool> selected(microBenchmarks.size(), false);
+  bool micro = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--lock-profile") == 0) {
+      LockProfiler::setEnabled(true);
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      TraceRecorder::setEnabled(true);
+    } else if (strcmp(argv[i], "--micro") == 0) {
+      micro = true;
+      selected.assign(selected.size(), true);
+    } else if (strncmp(argv[i], "--micro=", 8) == 0) {
+      micro = true;
+      if (!selectMicroBenchmarks(argv[i] + 8, selected)) {
+        return 1;
+      }
+    }
+  }
+
   cout << "Starting Benchmarks..." << endl;
 
   try {
-    runThreadBenchmark();
-    cout << "-----------------------------------------\n" << endl;
+    if (micro) {
+      for (size_t i = 0; i < microBenchmarks.size(); ++i) {
+        if (selected[i]) {
+          microBenchmarks[i].second();
+          cout << "-----------------------------------------\n" << endl;
+        }
+      }
+    } else {
+      runThreadBenchmark();
+      cout << "-----------------------------------------\n" << endl;
 
-    runIOBenchmark();
-    cout << "-----------------------------------------\n" << endl;
+      runIOBenchmark();
+      cout << "-----------------------------------------\n" << endl;
 
-    runCustomBenchmark();
-    cout << "-----------------------------------------\n" << endl;
+      runCustomBenchmark();
+      cout << "-----------------------------------------\n" << endl;
+    }
 
     cout << "Benchmarks completed successfully." << endl;
+
+    if (LockProfiler::isEnabled()) {
+      LockProfiler::printReport(cout);
+      LockProfiler::exportReportToCSV("LockProfile.csv");
+    }
   } catch (const exception &e) {
     cerr << "Error during benchmark execution: " << e.what() << endl;
     return 1;
   }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,163 @@
+#include "AsyncCSVWriter.h"
+#include "util/CycleClock.h"
+#include "util/TraceRecorder.h"
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+AsyncCSVWriter::AsyncCSVWriter(CSVHandler &sink, size_t bufferCapacity,
+                               QueueFullPolicy policy)
+    : sink(sink), bufferCapacity(bufferCapacity), fullPolicy(policy) {
+  if (bufferCapacity == 0) {
+    throw invalid_argument("Staging buffer capacity must be positive");
+  }
+  activeBuffer.reserve(bufferCapacity);
+  writerThread = thread(&AsyncCSVWriter::run, this);
+}
+
+AsyncCSVWriter::~AsyncCSVWriter() {
+  try {
+    close();
+  } catch (const exception &e) {
+    cerr << "Error flushing staged rows on close: " << e.what() << endl;
+  }
+}
+
+// background writer: take the active buffer whenever it holds rows and
+// write it while callers fill the other one
+void AsyncCSVWriter::run() {
+  string standbyBuffer;
+  standbyBuffer.reserve(bufferCapacity);
+  unique_lock<mutex> guard(stagingMutex);
+  while (true) {
+    rowsAvailable.wait(guard, [this] { return activeRows > 0 || stopping; });
+    if (activeRows == 0) {
+      break; // stopping and drained
+    }
+    activeBuffer.swap(standbyBuffer);
+    int batchRows = activeRows;
+    activeRows = 0;
+    uint64_t batchEnd = stagedSeq;
+    guard.unlock();
+    spaceAvailable.notify_all();
+
+    string error;
+    try {
+      TraceScope trace("AsyncCSVWriter::writeBatch", "csv");
+      sink.writeFormatted(standbyBuffer, batchRows);
+    } catch (const exception &e) {
+      error = e.what();
+    }
+    batchSizeHistogram.record(batchRows);
+    standbyBuffer.clear();
+
+    guard.lock();
+    if (!error.empty() && writeError.empty()) {
+      writeError = error;
+    }
+    writtenSeq = batchEnd;
+    batchWritten.notify_all();
+  }
+}
+
+// format outside the lock, then append to the active buffer
+bool AsyncCSVWriter::writeRow(const vector<string> &row) {
+  thread_local string line;
+  line.clear();
+  CSVHandler::formatRow(line, row);
+  return stageLine(line);
+}
+
+bool AsyncCSVWriter::writeRow(int id, string_view name, bool done) {
+  thread_local string line;
+  line.clear();
+  CSVHandler::formatRow(line, id, name, done);
+  return stageLine(line);
+}
+
+// the stage latency starts after formatting: the lock, any wait for space
+// and the append. Only every kLatencySampleEvery-th call of a thread is
+// timed, so the shared histogram stays off the per-row path.
+bool AsyncCSVWriter::stageLine(const string &line) {
+  thread_local unsigned calls = 0;
+  bool sampled = ++calls % kLatencySampleEvery == 0;
+  uint64_t start = sampled ? CycleClock::now() : 0;
+  unique_lock<mutex> guard(stagingMutex);
+  if (stopping) {
+    throw runtime_error("AsyncCSVWriter is closed");
+  }
+  if (!writeError.empty()) {
+    throw runtime_error(writeError);
+  }
+  // an empty buffer always takes the row, even one longer than the capacity
+  auto hasSpace = [this, &line] {
+    return activeBuffer.size() + line.size() <= bufferCapacity ||
+           activeRows == 0 || stopping;
+  };
+  if (!hasSpace()) {
+    if (fullPolicy == QueueFullPolicy::DropNewest) {
+      rowsDropped++;
+      return false;
+    }
+    fullWaits++;
+    spaceAvailable.wait(guard, hasSpace);
+    if (stopping) {
+      throw runtime_error("AsyncCSVWriter is closed");
+    }
+  }
+  activeBuffer += line;
+  bool wakeWriter = activeRows == 0;
+  activeRows++;
+  stagedSeq++;
+  guard.unlock();
+  if (wakeWriter) {
+    rowsAvailable.notify_one();
+  }
+  if (sampled) {
+    stageLatencyHistogram.record(
+        CycleClock::toNanoseconds(CycleClock::now() - start));
+  }
+  return true;
+}
+
+void AsyncCSVWriter::flush() {
+  unique_lock<mutex> guard(stagingMutex);
+  uint64_t target = stagedSeq;
+  batchWritten.wait(guard, [this, target] { return writtenSeq >= target; });
+  if (!writeError.empty()) {
+    throw runtime_error(writeError);
+  }
+}
+
+void AsyncCSVWriter::close() {
+  {
+    lock_guard<mutex> guard(stagingMutex);
+    if (stopping && !writerThread.joinable()) {
+      return; // already closed
+    }
+    stopping = true;
+  }
+  rowsAvailable.notify_one();
+  spaceAvailable.notify_all();
+  if (writerThread.joinable()) {
+    writerThread.join(); // the writer drains the active buffer first
+  }
+  lock_guard<mutex> guard(stagingMutex);
+  if (!writeError.empty()) {
+    throw runtime_error(writeError);
+  }
+}
+
+QueueFullPolicy AsyncCSVWriter::getQueueFullPolicy() const {
+  return fullPolicy;
+}
+size_t AsyncCSVWriter::getBufferCapacity() const { return bufferCapacity; }
+long AsyncCSVWriter::getRowsDropped() const { return rowsDropped.load(); }
+long AsyncCSVWriter::getFullWaits() const { return fullWaits.load(); }
+const Histogram &AsyncCSVWriter::getBatchSizeHistogram() const {
+  return batchSizeHistogram;
+}
+const Histogram &AsyncCSVWriter::getStageLatencyHistogram() const {
+  return stageLatencyHistogram;
+}
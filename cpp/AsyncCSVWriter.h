@@ -0,0 +1,84 @@
+#ifndef ASYNCCSVWRITER_H
+#define ASYNCCSVWRITER_H
+
+#include "CSVHandler.h"
+#include "util/Histogram.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// What writeRow does when the staging buffer is full
+enum class QueueFullPolicy {
+  Block,     // wait for the writer to take the buffer (default)
+  DropNewest // discard the row and count it, never wait
+};
+
+// Asynchronous sink in front of a CSVHandler. Callers format their row into
+// the active staging buffer and return; one background thread swaps the
+// active and standby buffers and writes the whole standby buffer with a
+// single CSVHandler::writeFormatted call. While a batch is being written,
+// new rows fill the other buffer, so callers only wait on disk latency when
+// that buffer reaches its capacity.
+class AsyncCSVWriter {
+private:
+  CSVHandler &sink;
+  size_t bufferCapacity; // bytes per staging buffer
+  QueueFullPolicy fullPolicy;
+
+  std::mutex stagingMutex;
+  std::condition_variable rowsAvailable;  // wakes the writer
+  std::condition_variable spaceAvailable; // wakes blocked writeRow calls
+  std::condition_variable batchWritten;   // wakes flush()
+  std::string activeBuffer; // rows being staged, guarded by stagingMutex
+  int activeRows = 0;
+  uint64_t stagedSeq = 0;  // rows staged so far
+  uint64_t writtenSeq = 0; // rows staged before this are in the file
+  bool stopping = false;
+  std::string writeError; // first failed batch, reported to callers
+
+  std::atomic<long> rowsDropped{0};
+  std::atomic<long> fullWaits{0}; // writeRow calls that had to block
+  Histogram batchSizeHistogram;   // rows per background write
+  Histogram stageLatencyHistogram; // sampled writeRow latency (ns)
+
+  std::thread writerThread;
+  void run();
+  bool stageLine(const std::string &line);
+
+public:
+  static const size_t kDefaultBufferCapacity = 1 << 20;
+  static const unsigned kLatencySampleEvery = 64; // calls per thread
+
+  explicit AsyncCSVWriter(CSVHandler &sink,
+                          size_t bufferCapacity = kDefaultBufferCapacity,
+                          QueueFullPolicy policy = QueueFullPolicy::Block);
+  ~AsyncCSVWriter(); // close(), errors are logged
+
+  AsyncCSVWriter(const AsyncCSVWriter &) = delete;
+  AsyncCSVWriter &operator=(const AsyncCSVWriter &) = delete;
+
+  // Stage a row; returns false if it was dropped (DropNewest). Throws once a
+  // background write has failed or after close()
+  bool writeRow(const std::vector<std::string> &row);
+  // Typed task row, see CSVHandler::writeRow(int, string_view, bool)
+  bool writeRow(int id, std::string_view name, bool done);
+  // Wait until every row staged before the call is written to the file
+  void flush();
+  // Write the remaining rows and stop the writer thread
+  void close();
+
+  QueueFullPolicy getQueueFullPolicy() const;
+  size_t getBufferCapacity() const;
+  long getRowsDropped() const;
+  long getFullWaits() const;
+  const Histogram &getBatchSizeHistogram() const;
+  // time to stage a formatted row, one in kLatencySampleEvery calls
+  const Histogram &getStageLatencyHistogram() const;
+};
+
+#endif // ASYNCCSVWRITER_H
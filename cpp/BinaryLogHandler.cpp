@@ -0,0 +1,447 @@
+#include "BinaryLogHandler.h"
+#include "util/CycleClock.h"
+#include "util/CSVRowReader.h"
+#include "util/TraceRecorder.h"
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+const uint32_t kBlockMagic = 0x31474c42; // "BLG1"
+
+// block header: magic, rows, new names, new statuses, payload bytes, crc
+const size_t kHeaderWords = 6;
+const size_t kHeaderSize = kHeaderWords * sizeof(uint32_t);
+
+// CRC-32 (IEEE 802.3, reflected), table built on first use
+uint32_t crc32(const char *data, size_t size) {
+  static const auto table = [] {
+    array<uint32_t, 256> entries{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+      }
+      entries[i] = value;
+    }
+    return entries;
+  }();
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffffu;
+}
+
+template <typename T> void appendValue(string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> void appendArray(string &out, const vector<T> &values) {
+  out.append(reinterpret_cast<const char *>(values.data()),
+             values.size() * sizeof(T));
+}
+
+template <typename T> T readValue(const char *data) {
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+void writeFully(int fd, const char *data, size_t size, const string &path) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = ::write(fd, data + written, size - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("File write operation failed: " + path + ": " +
+                          strerror(errno));
+    }
+    written += result;
+  }
+}
+
+string readWholeFile(const string &path) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open()) {
+    throw runtime_error("Cannot open file for reading: " + path);
+  }
+  ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+long parseId(const string &cell) {
+  long id = 0;
+  auto [end, error] = from_chars(cell.data(), cell.data() + cell.size(), id);
+  if (error != errc() || end != cell.data() + cell.size()) {
+    throw invalid_argument("Task id is not an integer: " + cell);
+  }
+  return id;
+}
+} // namespace
+
+// constructor, create or truncate the log file
+BinaryLogHandler::BinaryLogHandler(const string &path, LockType lockType)
+    : filePath(path), lockType(lockType) {
+  writeFd = open(filePath.c_str(),
+                 O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (writeFd < 0) {
+    throw runtime_error("Cannot open file for writing: " + filePath);
+  }
+}
+
+// destructor, write out the open block and close the file
+BinaryLogHandler::~BinaryLogHandler() {
+  try {
+    flushBlock();
+  } catch (const exception &e) {
+    cerr << "Error flushing rows on close: " << e.what() << endl;
+  }
+  if (writeFd >= 0) {
+    ::close(writeFd);
+  }
+}
+
+// lock the file according to the lock type
+void BinaryLogHandler::lock(LockType lockType, LockOperation operation,
+                            const char *site) {
+  if (lockType == LockType::Mutex) {
+    fileMutex.mutexLockOn(site);
+  } else if (lockType == LockType::RWLock) {
+    if (operation == LockOperation::Write) {
+      fileRWLock.writeLock();
+    } else {
+      fileRWLock.readLock();
+    }
+  } else {
+    throw runtime_error("Invalid lock type");
+  }
+}
+
+// unlock the file according to the lock type
+void BinaryLogHandler::unlock(LockType lockType, LockOperation operation) {
+  if (lockType == LockType::Mutex) {
+    fileMutex.mutexUnlock();
+  } else if (lockType == LockType::RWLock) {
+    if (operation == LockOperation::Write) {
+      fileRWLock.writeUnlock();
+    } else {
+      fileRWLock.readUnlock();
+    }
+  } else {
+    throw runtime_error("Invalid lock type");
+  }
+}
+
+// encode the open block with the dictionary entries it introduced
+void BinaryLogHandler::flushBlock() {
+  if (blockIds.empty()) {
+    return;
+  }
+  uint32_t newNames = names.size() - writtenNames;
+  uint32_t newStatuses = statuses.size() - writtenStatuses;
+
+  string block(kHeaderSize, '\0');
+  for (size_t i = writtenNames; i < names.size(); ++i) {
+    appendValue<uint32_t>(block, names[i].size());
+    block += names[i];
+  }
+  for (size_t i = writtenStatuses; i < statuses.size(); ++i) {
+    appendValue<uint32_t>(block, statuses[i].size());
+    block += statuses[i];
+  }
+  appendArray(block, blockIds);
+  appendArray(block, blockStatuses);
+  appendArray(block, blockNames);
+
+  uint32_t payloadSize = block.size() - kHeaderSize;
+  uint32_t header[kHeaderWords] = {
+      kBlockMagic,
+      static_cast<uint32_t>(blockIds.size()),
+      newNames,
+      newStatuses,
+      payloadSize,
+      crc32(block.data() + kHeaderSize, payloadSize)};
+  memcpy(&block[0], header, kHeaderSize);
+
+  // one write per block, a crash leaves at most a torn last block
+  writeFully(writeFd, block.data(), block.size(), filePath);
+  writtenNames = names.size();
+  writtenStatuses = statuses.size();
+  blockIds.clear();
+  blockStatuses.clear();
+  blockNames.clear();
+}
+
+// add one record to the open block, caller holds the write lock
+void BinaryLogHandler::appendRecordUnlocked(long id, string_view name,
+                                            string_view status) {
+  auto nameIt = nameCodes.find(name);
+  if (nameIt == nameCodes.end()) {
+    names.emplace_back(name);
+    nameIt = nameCodes.emplace(names.back(), names.size() - 1).first;
+  }
+  auto statusIt = statusCodes.find(status);
+  if (statusIt == statusCodes.end()) {
+    if (statuses.size() > UINT8_MAX) {
+      throw runtime_error("Too many distinct statuses in " + filePath);
+    }
+    statuses.emplace_back(status);
+    statusIt = statusCodes.emplace(statuses.back(), statuses.size() - 1).first;
+  }
+  blockIds.push_back(id);
+  blockNames.push_back(nameIt->second);
+  blockStatuses.push_back(statusIt->second);
+  if (blockIds.size() >= blockRows) {
+    flushBlock();
+  }
+}
+
+// write a {id, name, status} row
+void BinaryLogHandler::writeRow(const vector<string> &row) {
+  if (row.size() != 3) {
+    throw invalid_argument("Binary log rows have 3 cells: id, name, status");
+  }
+  writeRecord(parseId(row[0]), row[1], row[2]);
+}
+
+// write one record, buffered until its block is full
+void BinaryLogHandler::writeRecord(long id, string_view name,
+                                   string_view status) {
+  TraceScope trace("BinaryLogHandler::writeRecord", "binlog");
+  uint64_t start = CycleClock::now();
+
+  lock(lockType, LockOperation::Write, "BinaryLogHandler::writeRecord");
+  try {
+    appendRecordUnlocked(id, name, status);
+  } catch (const exception &e) {
+    cerr << "Error writing record to file: " << e.what() << endl;
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  unlock(lockType, LockOperation::Write);
+
+  writeCount++;
+  totalWriteTime += CycleClock::now() - start;
+}
+
+// decode every block of a log file
+long BinaryLogHandler::readFile(const string &path,
+                                const RecordVisitor &visit) {
+  string contents = readWholeFile(path);
+  vector<string> names;
+  vector<string> statuses;
+  long records = 0;
+
+  size_t offset = 0;
+  while (offset < contents.size()) {
+    if (contents.size() - offset < kHeaderSize) {
+      cerr << "Ignoring torn block at offset " << offset << " of " << path
+           << endl;
+      break;
+    }
+    uint32_t header[kHeaderWords];
+    memcpy(header, contents.data() + offset, kHeaderSize);
+    if (header[0] != kBlockMagic) {
+      throw runtime_error("Bad block magic at offset " +
+                          to_string(offset) + " of " + path);
+    }
+    uint32_t rows = header[1];
+    uint32_t payloadSize = header[4];
+    const char *payload = contents.data() + offset + kHeaderSize;
+    if (contents.size() - offset - kHeaderSize < payloadSize) {
+      cerr << "Ignoring torn block at offset " << offset << " of " << path
+           << endl;
+      break;
+    }
+    if (crc32(payload, payloadSize) != header[5]) {
+      throw runtime_error("Checksum mismatch in block at offset " +
+                          to_string(offset) + " of " + path);
+    }
+
+    // dictionary entries first, then the columns
+    const char *cursor = payload;
+    const char *payloadEnd = payload + payloadSize;
+    auto readEntries = [&](uint32_t count, vector<string> &dictionary) {
+      for (uint32_t i = 0; i < count; ++i) {
+        if (payloadEnd - cursor < static_cast<long>(sizeof(uint32_t))) {
+          throw runtime_error("Corrupt dictionary in " + path);
+        }
+        uint32_t length = readValue<uint32_t>(cursor);
+        cursor += sizeof(uint32_t);
+        if (payloadEnd - cursor < static_cast<long>(length)) {
+          throw runtime_error("Corrupt dictionary in " + path);
+        }
+        dictionary.emplace_back(cursor, length);
+        cursor += length;
+      }
+    };
+    readEntries(header[2], names);
+    readEntries(header[3], statuses);
+
+    size_t columnBytes =
+        static_cast<size_t>(rows) *
+        (sizeof(int64_t) + sizeof(uint8_t) + sizeof(uint32_t));
+    if (static_cast<size_t>(payloadEnd - cursor) != columnBytes) {
+      throw runtime_error("Corrupt block columns in " + path);
+    }
+    const char *ids = cursor;
+    const char *statusColumn = ids + rows * sizeof(int64_t);
+    const char *nameColumn = statusColumn + rows * sizeof(uint8_t);
+    for (uint32_t i = 0; i < rows; ++i) {
+      uint8_t statusCode = statusColumn[i];
+      uint32_t nameCode =
+          readValue<uint32_t>(nameColumn + i * sizeof(uint32_t));
+      if (statusCode >= statuses.size() || nameCode >= names.size()) {
+        throw runtime_error("Dictionary code out of range in " + path);
+      }
+      visit(readValue<int64_t>(ids + i * sizeof(int64_t)), names[nameCode],
+            statuses[statusCode]);
+    }
+    records += rows;
+    offset += kHeaderSize + payloadSize;
+  }
+  return records;
+}
+
+// read every record, including the ones still in the open block
+vector<vector<string>> BinaryLogHandler::readAll() {
+  TraceScope trace("BinaryLogHandler::readAll", "binlog");
+  uint64_t start = CycleClock::now();
+  vector<vector<string>> data;
+  auto collect = [&data](long id, string_view name, string_view status) {
+    data.push_back({to_string(id), string(name), string(status)});
+  };
+
+  lock(lockType, LockOperation::Read, "BinaryLogHandler::readAll");
+  try {
+    readFile(filePath, collect);
+    for (size_t i = 0; i < blockIds.size(); ++i) {
+      collect(blockIds[i], names[blockNames[i]], statuses[blockStatuses[i]]);
+    }
+  } catch (const exception &e) {
+    cerr << "Error reading binary log: " << e.what() << endl;
+    unlock(lockType, LockOperation::Read);
+    throw;
+  }
+  unlock(lockType, LockOperation::Read);
+
+  readCount++;
+  totalReadTime += CycleClock::now() - start;
+  return data;
+}
+
+// truncate the file and forget the dictionaries
+void BinaryLogHandler::clear() {
+  lock(lockType, LockOperation::Write, "BinaryLogHandler::clear");
+  blockIds.clear();
+  blockStatuses.clear();
+  blockNames.clear();
+  nameCodes.clear();
+  names.clear();
+  statusCodes.clear();
+  statuses.clear();
+  writtenNames = 0;
+  writtenStatuses = 0;
+  if (ftruncate(writeFd, 0) != 0) {
+    unlock(lockType, LockOperation::Write);
+    throw runtime_error("Cannot truncate file: " + filePath);
+  }
+  unlock(lockType, LockOperation::Write);
+}
+
+void BinaryLogHandler::flush() {
+  lock(lockType, LockOperation::Write, "BinaryLogHandler::flush");
+  try {
+    flushBlock();
+  } catch (...) {
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  unlock(lockType, LockOperation::Write);
+}
+
+void BinaryLogHandler::setBlockRows(size_t rows) {
+  if (rows == 0) {
+    throw invalid_argument("Block size must be at least one row");
+  }
+  lock(lockType, LockOperation::Write, "BinaryLogHandler::setBlockRows");
+  try {
+    flushBlock();
+  } catch (...) {
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  blockRows = rows;
+  unlock(lockType, LockOperation::Write);
+}
+
+size_t BinaryLogHandler::getBlockRows() const { return blockRows; }
+
+// copy a CSV file of {id, name, status} rows into a new binary log
+long BinaryLogHandler::convertFromCSV(const string &csvPath,
+                                      const string &binaryPath) {
+  BinaryLogHandler log(binaryPath);
+  CSVRowReader reader(csvPath);
+  CSVRow row;
+  vector<string> cells;
+  long rows = 0;
+  while (reader.next(row)) {
+    if (row.size() != 3) {
+      throw invalid_argument("Row " + to_string(rows) + " of " + csvPath +
+                             " does not have 3 cells");
+    }
+    cells.assign(row.begin(), row.end());
+    log.writeRow(cells);
+    rows++;
+  }
+  log.flush();
+  return rows;
+}
+
+// write a binary log back out as CSV
+long BinaryLogHandler::convertToCSV(const string &binaryPath,
+                                    const string &csvPath) {
+  CSVHandler csv(csvPath);
+  csv.setFlushPolicy(FlushPolicy::EveryNBytes, 1 << 16);
+  long rows = readFile(binaryPath, [&csv](long id, string_view name,
+                                          string_view status) {
+    csv.writeRow({to_string(id), string(name), string(status)});
+  });
+  csv.flush();
+  return rows;
+}
+
+// ----------------------------------------------
+long BinaryLogHandler::getTotalWriteTime() const {
+  return CycleClock::toMicroseconds(totalWriteTime);
+}
+long BinaryLogHandler::getTotalReadTime() const {
+  return CycleClock::toMicroseconds(totalReadTime);
+}
+int BinaryLogHandler::getWriteCount() const { return writeCount; }
+int BinaryLogHandler::getReadCount() const { return readCount; }
+
+int BinaryLogHandler::getMutexContention() const {
+  return fileMutex.getContentionCount();
+}
+int BinaryLogHandler::getRWReadContention() const {
+  return fileRWLock.getReadContentionByWriteCount();
+}
+int BinaryLogHandler::getRWWriteContention() const {
+  return fileRWLock.getWriteContentionCount();
+}
+
+LockType BinaryLogHandler::getLockType() const { return lockType; }
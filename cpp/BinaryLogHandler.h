@@ -0,0 +1,110 @@
+#ifndef BINARYLOGHANDLER_H
+#define BINARYLOGHANDLER_H
+
+#include "CSVHandler.h" // LockOperation
+#include "util/LockType.h"
+#include "util/MutexLock.h"
+#include "util/RWLock.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Compact binary log of task-completion records (id, name, status), with
+// the same writer/reader interface and locking options as CSVHandler.
+//
+// The file is a sequence of blocks, written with one write(2) each:
+//   header   magic, row count, new name / status dictionary entries,
+//            payload size, CRC32 of the payload (six uint32, host order)
+//   payload  new dictionary entries (uint32 length + bytes), then the
+//            columns: int64 id[rows], uint8 status[rows], uint32 name[rows]
+// Names and statuses are dictionary codes; every block only carries the
+// entries it introduces, so a reader rebuilds the dictionaries in order.
+// Rows are buffered until a block is full, flush() or destruction;
+// readAll also returns the rows still buffered.
+class BinaryLogHandler {
+private:
+  std::string filePath;
+  LockType lockType;
+  MutexLock fileMutex;
+  RWLock fileRWLock;
+  int writeFd = -1;
+
+  // Dictionaries and the open block, guarded by the write lock. The code
+  // maps key views into the deques, which never move their strings.
+  std::unordered_map<std::string_view, uint32_t> nameCodes;
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, uint8_t> statusCodes;
+  std::deque<std::string> statuses;
+  size_t writtenNames = 0;    // dictionary entries already in the file
+  size_t writtenStatuses = 0;
+  std::vector<int64_t> blockIds;
+  std::vector<uint8_t> blockStatuses;
+  std::vector<uint32_t> blockNames;
+  size_t blockRows = 1024; // rows per block
+
+  // Benchmark statistics, times are CycleClock ticks, getters return us
+  std::atomic<long> totalWriteTime{0};
+  std::atomic<long> totalReadTime{0};
+  std::atomic<int> writeCount{0};
+  std::atomic<int> readCount{0};
+
+  void flushBlock(); // caller holds the write lock
+  void appendRecordUnlocked(long id, std::string_view name,
+                            std::string_view status);
+
+  void lock(LockType lockType, LockOperation operation,
+            const char *site = "BinaryLogHandler::lock");
+  void unlock(LockType lockType, LockOperation operation);
+
+public:
+  // visit every record of a binary log file in order
+  using RecordVisitor = std::function<void(long id, std::string_view name,
+                                           std::string_view status)>;
+
+  // Creates (or truncates) the log file
+  BinaryLogHandler(const std::string &path,
+                   LockType lockType = LockType::Mutex);
+  ~BinaryLogHandler();
+
+  BinaryLogHandler(const BinaryLogHandler &) = delete;
+  BinaryLogHandler &operator=(const BinaryLogHandler &) = delete;
+
+  // row is {id, name, status}; the id must be an integer
+  void writeRow(const std::vector<std::string> &row);
+  void writeRecord(long id, std::string_view name, std::string_view status);
+  std::vector<std::vector<std::string>> readAll();
+  void clear();
+  void flush(); // write the open block
+
+  // rows per block, the open block is written first
+  void setBlockRows(size_t rows);
+  size_t getBlockRows() const;
+
+  // Decode a log file; throws on a bad magic or checksum. A torn last
+  // block (crash mid-write) ends the log. Returns the records visited.
+  static long readFile(const std::string &path, const RecordVisitor &visit);
+
+  // Converters, return the number of rows copied
+  static long convertFromCSV(const std::string &csvPath,
+                             const std::string &binaryPath);
+  static long convertToCSV(const std::string &binaryPath,
+                           const std::string &csvPath);
+
+  // Getters for benchmark statistics (us)
+  long getTotalWriteTime() const;
+  long getTotalReadTime() const;
+  int getWriteCount() const;
+  int getReadCount() const;
+
+  int getMutexContention() const;
+  int getRWReadContention() const;
+  int getRWWriteContention() const;
+  LockType getLockType() const;
+};
+
+#endif // BINARYLOGHANDLER_H
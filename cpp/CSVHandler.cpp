@@ -1,8 +1,90 @@
 #include "CSVHandler.h" // Ensure this file exists in the same directory or update the include path
+#include "util/CycleClock.h"
+#include "util/TraceRecorder.h"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
+
+namespace {
+// flush file data (not metadata) to the device
+int syncFileData(int fd) {
+#if defined(__APPLE__)
+  return fsync(fd);
+#else
+  return fdatasync(fd);
+#endif
+}
+
+// pwrite the whole range, false (errno set) on failure
+bool pwriteFully(int fd, const char *bytes, size_t length, size_t offset) {
+  while (length > 0) {
+    ssize_t result = pwrite(fd, bytes, length, offset);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+    bytes += result;
+    length -= result;
+    offset += result;
+  }
+  return true;
+}
+
+// format cells as one CSV line, see CSVHandler::formatRow
+template <typename CellIterator>
+void formatCells(string &out, CellIterator first, CellIterator last) {
+  for (CellIterator it = first; it != last; ++it) {
+    string_view cell = *it;
+    if (it != first) {
+      out += ',';
+    }
+    if (cell.find_first_of(",\"\r\n") == string_view::npos) {
+      out += cell;
+    } else {
+      out += '"';
+      for (char c : cell) {
+        if (c == '"') {
+          out += '"'; // "" escapes a quote
+        }
+        out += c;
+      }
+      out += '"';
+    }
+  }
+  out += '\n';
+}
+} // namespace
+
+// format one row as a CSV line, including the trailing newline. Cells with
+// a delimiter, quote or line break are quoted as RFC 4180 describes.
+void CSVHandler::formatRow(string &out, const vector<string> &row) {
+  formatCells(out, row.begin(), row.end());
+}
+
+void CSVHandler::formatRow(string &out, const CSVRow &row) {
+  formatCells(out, row.begin(), row.end());
+}
+
+// the id goes through to_chars: no temporary string, no locale
+void CSVHandler::formatRow(string &out, int id, string_view name,
+                           bool done) {
+  char digits[16];
+  auto result = to_chars(digits, digits + sizeof(digits), id);
+  const string_view cells[] = {
+      string_view(digits, result.ptr - digits), name,
+      done ? string_view("Complete") : string_view("Incomplete")};
+  formatCells(out, begin(cells), end(cells));
+}
+
 // test this is being send to Git
 //  constructor, check if the file exists, if not create a new file
 CSVHandler::CSVHandler(const string &path, LockType lockType)
@@ -25,19 +107,364 @@ CSVHandler::CSVHandler(const string &path, LockType lockType)
     }
     cerr << "File not found, new file created: " << filePath << endl;
   }
+
+  // one descriptor for the lifetime of the handler, writeRow appends to it
+  writeFd = open(filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+                 0644);
+  if (writeFd < 0) {
+    throw runtime_error("Cannot open file for writing: " + filePath);
+  }
+  readFd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (readFd < 0) {
+    throw runtime_error("Cannot open file for reading: " + filePath);
+  }
+  publishCommitted();
+  lastFlushTicks = CycleClock::now();
 }
 
-// destructor, close the file stream
+// destructor, write out buffered rows and close the file
 CSVHandler::~CSVHandler() {
+  stopIntervalFlusher();
+  try {
+    flushBuffer();
+    writeDirectTail();
+  } catch (const exception &e) {
+    cerr << "Error flushing rows on close: " << e.what() << endl;
+  }
+  if (writeFd >= 0) {
+    ::close(writeFd);
+  }
+  if (readFd >= 0) {
+    ::close(readFd);
+  }
+  closeIOBackend();
   if (fileStream.is_open()) {
     fileStream.close();
   }
 }
 
+// check the flush policy against the buffered rows
+bool CSVHandler::shouldFlush() const {
+  switch (flushPolicy) {
+  case FlushPolicy::PerRow:
+    return true;
+  case FlushPolicy::EveryNRows:
+    return bufferedRows >= flushThreshold;
+  case FlushPolicy::EveryNBytes:
+    return static_cast<long>(writeBuffer.size()) >= flushThreshold;
+  case FlushPolicy::Interval:
+    return CycleClock::toNanoseconds(CycleClock::now() - lastFlushTicks) >=
+           flushThreshold * 1000000L;
+  case FlushPolicy::OnClose:
+    return false;
+  }
+  return true;
+}
+
+// write the whole range, retrying on partial writes and EINTR
+void CSVHandler::writeFully(const char *data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = ::write(writeFd, data + written, size - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("File write operation failed: " + filePath + ": " +
+                          strerror(errno));
+    }
+    written += result;
+  }
+}
+
+// append under the write lock and index the rows that reached the file;
+// with io_uring the chunks are written at explicit offsets past the current
+// end, all in flight at once
+void CSVHandler::writeLocked(const char *data, size_t size) {
+  if (directFd >= 0) {
+    writeDirect(data, size); // indexes what it writes
+    if (durability != Durability::None) {
+      writeDirectTail(); // the rows must be in the file on return
+    }
+    return;
+  }
+  if (!ring) {
+    writeFully(data, size);
+  } else if (size > 0) {
+    struct stat fileStat;
+    if (fstat(writeFd, &fileStat) != 0) {
+      throw runtime_error("Cannot stat file: " + filePath);
+    }
+    ring->writeAll(positionalWriteFd, data, size, fileStat.st_size);
+  }
+  rowIndex.append(data, size);
+}
+
+// stage the bytes behind the partial last block and write every whole
+// block with O_DIRECT; the partial block stays staged until it fills or
+// writeDirectTail() pads it out
+void CSVHandler::writeDirect(const char *data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  struct stat fileStat;
+  if (fstat(writeFd, &fileStat) != 0) {
+    throw runtime_error("Cannot stat file: " + filePath);
+  }
+  size_t fileSize = fileStat.st_size;
+  if (fileSize != directOffset + directWritten) {
+    // first write, or rows went through another backend: reload the
+    // file's partial last block
+    directOffset = fileSize / kDirectAlignment * kDirectAlignment;
+    directStaged = fileSize - directOffset;
+    directWritten = directStaged;
+    if (pread(readFd, directBuffer.get(), directStaged, directOffset) !=
+        static_cast<ssize_t>(directStaged)) {
+      throw runtime_error("Error reading file: " + filePath);
+    }
+  }
+
+  while (size > 0) {
+    size_t chunk = min(size, kDirectBufferSize - directStaged);
+    memcpy(directBuffer.get() + directStaged, data, chunk);
+    directStaged += chunk;
+    data += chunk;
+    size -= chunk;
+
+    size_t whole = directStaged / kDirectAlignment * kDirectAlignment;
+    if (whole == 0) {
+      continue;
+    }
+    if (directFd >= 0 &&
+        !pwriteFully(directFd, directBuffer.get(), whole, directOffset)) {
+      if (errno != EINVAL) {
+        throw runtime_error("File write operation failed: " + filePath +
+                            ": " + strerror(errno));
+      }
+      // accepted at open, rejected on write (e.g. a larger logical block
+      // size): finish this write and the rest through the page cache
+      cerr << "O_DIRECT write rejected, using buffered writes for "
+           << filePath << endl;
+      ::close(directFd);
+      directFd = -1;
+      ioBackend = IOBackend::Sync;
+    }
+    if (directFd < 0) {
+      if (!pwriteFully(positionalWriteFd, directBuffer.get(), whole,
+                       directOffset)) {
+        throw runtime_error("File write operation failed: " + filePath +
+                            ": " + strerror(errno));
+      }
+      bufferedBytes += whole;
+    } else {
+      directBytes += whole;
+    }
+    // a padded tail already put the first directWritten bytes in the file
+    size_t indexed = min(directWritten, whole);
+    rowIndex.append(directBuffer.get() + indexed, whole - indexed);
+    directWritten -= indexed;
+    directOffset += whole;
+    directStaged -= whole;
+    memmove(directBuffer.get(), directBuffer.get() + whole, directStaged);
+  }
+
+  if (directFd < 0) {
+    // fell back above: the partial block goes through the page cache too,
+    // later writes take write(2)
+    if (directStaged > directWritten &&
+        !pwriteFully(positionalWriteFd, directBuffer.get() + directWritten,
+                     directStaged - directWritten,
+                     directOffset + directWritten)) {
+      throw runtime_error("File write operation failed: " + filePath + ": " +
+                          strerror(errno));
+    }
+    bufferedBytes += directStaged - directWritten;
+    rowIndex.append(directBuffer.get() + directWritten,
+                    directStaged - directWritten);
+    directBuffer.reset();
+    directOffset = 0;
+    directStaged = 0;
+    directWritten = 0;
+  }
+}
+
+// write the staged partial block with O_DIRECT, zero padded to a whole
+// block, then cut the padding off; the block stays staged and is written
+// again once it fills
+void CSVHandler::writeDirectTail() {
+  if (directFd < 0 || directStaged == directWritten) {
+    return;
+  }
+  size_t padded = (directStaged + kDirectAlignment - 1) / kDirectAlignment *
+                  kDirectAlignment;
+  memset(directBuffer.get() + directStaged, 0, padded - directStaged);
+  if (!pwriteFully(directFd, directBuffer.get(), padded, directOffset) ||
+      ftruncate(positionalWriteFd, directOffset + directStaged) != 0) {
+    throw runtime_error("File write operation failed: " + filePath + ": " +
+                        strerror(errno));
+  }
+  directBytes += padded;
+  rowIndex.append(directBuffer.get() + directWritten,
+                  directStaged - directWritten);
+  directWritten = directStaged;
+  publishCommitted();
+}
+
+// write the whole buffer with as few write(2) calls as possible
+void CSVHandler::flushBuffer() {
+  writeLocked(writeBuffer.data(), writeBuffer.size());
+  publishCommitted();
+  writeBuffer.clear();
+  bufferedRows = 0;
+  lastFlushTicks = CycleClock::now();
+}
+
+void CSVHandler::startIntervalFlusher() {
+  intervalStopping = false;
+  intervalFlusher = thread(&CSVHandler::runIntervalFlusher, this);
+}
+
+// caller must not hold the write lock, the flusher may be waiting for it
+void CSVHandler::stopIntervalFlusher() {
+  if (!intervalFlusher.joinable()) {
+    return;
+  }
+  {
+    lock_guard<mutex> guard(intervalMutex);
+    intervalStopping = true;
+  }
+  intervalCondition.notify_all();
+  intervalFlusher.join();
+}
+
+// sleep until the oldest buffered row is due, then flush what writeRow
+// left behind; writers that keep going flush on their own first
+void CSVHandler::runIntervalFlusher() {
+  const long intervalNs = flushThreshold * 1000000L;
+  while (true) {
+    long waitNs = intervalNs;
+    lock(lockType, LockOperation::Write, "CSVHandler::intervalFlush");
+    try {
+      long sinceFlushNs =
+          CycleClock::toNanoseconds(CycleClock::now() - lastFlushTicks);
+      if (writeBuffer.empty()) {
+        lastFlushTicks = CycleClock::now(); // nothing is waiting
+      } else if (sinceFlushNs >= intervalNs) {
+        flushBuffer();
+      } else {
+        waitNs = intervalNs - sinceFlushNs;
+      }
+    } catch (const exception &e) {
+      cerr << "Error flushing rows on interval: " << e.what() << endl;
+    }
+    unlock(lockType, LockOperation::Write);
+
+    unique_lock<mutex> guard(intervalMutex);
+    if (intervalCondition.wait_for(guard, chrono::nanoseconds(waitNs),
+                                   [this] { return intervalStopping; })) {
+      return;
+    }
+  }
+}
+
+// lock-free append: emit the row with a single write(2); O_APPEND makes
+// each write land whole at the file end. A short write is never finished
+// with a second call, another writer's row could land in between.
+void CSVHandler::appendRowUnlocked(string_view line) {
+  ssize_t result;
+  do {
+    result = ::write(writeFd, line.data(), line.size()); // EINTR: no bytes
+  } while (result < 0 && errno == EINTR);
+  if (result < 0) {
+    throw runtime_error("File write operation failed: " + filePath + ": " +
+                        strerror(errno));
+  }
+  if (static_cast<size_t>(result) != line.size()) {
+    throw runtime_error("Short append, row left incomplete: " + filePath);
+  }
+  if (durability == Durability::FDataSync) {
+    uint64_t syncStart = CycleClock::now();
+    if (syncFileData(writeFd) != 0) {
+      throw runtime_error("fdatasync failed: " + filePath + ": " +
+                          strerror(errno));
+    }
+    syncLatencyHistogram.record(
+        CycleClock::toMicroseconds(CycleClock::now() - syncStart));
+  }
+}
+
+// queue a formatted row and return once its batch is committed; the first
+// writer to find no active leader writes (and syncs) the whole batch
+void CSVHandler::groupCommitRow(string_view line) {
+  unique_lock<mutex> guard(commitMutex);
+  commitBatch += line;
+  commitBatchRows++;
+  uint64_t sequence = ++enqueuedSeq;
+
+  while (resolvedSeq < sequence) {
+    if (commitLeaderActive) {
+      commitCondition.wait(guard); // follower, the leader will release us
+      continue;
+    }
+
+    // become the leader for everything queued so far
+    commitLeaderActive = true;
+    string batch;
+    batch.swap(commitBatch);
+    int batchRows = commitBatchRows;
+    commitBatchRows = 0;
+    uint64_t batchBegin = resolvedSeq;
+    uint64_t batchEnd = enqueuedSeq;
+    guard.unlock();
+
+    string error;
+    lock(lockType, LockOperation::Write, "CSVHandler::groupCommit");
+    try {
+      writeLocked(batch.data(), batch.size());
+      if (durability == Durability::FDataSync) {
+        uint64_t syncStart = CycleClock::now();
+        if (syncFileData(writeFd) != 0) {
+          throw runtime_error("fdatasync failed: " + filePath + ": " +
+                              strerror(errno));
+        }
+        syncLatencyHistogram.record(
+            CycleClock::toMicroseconds(CycleClock::now() - syncStart));
+      }
+      publishCommitted(); // snapshot readers see the batch once it is synced
+    } catch (const exception &e) {
+      error = e.what();
+    }
+    unlock(lockType, LockOperation::Write);
+    batchSizeHistogram.record(batchRows);
+
+    guard.lock();
+    if (!error.empty()) {
+      failedBatches.push_back(
+          {batchBegin, batchEnd, move(error), batchEnd - batchBegin});
+    }
+    resolvedSeq = batchEnd;
+    commitLeaderActive = false;
+    commitCondition.notify_all();
+  }
+
+  for (auto failed = failedBatches.begin(); failed != failedBatches.end();
+       ++failed) {
+    if (sequence > failed->begin && sequence <= failed->end) {
+      runtime_error failure(failed->error);
+      if (--failed->unreported == 0) {
+        failedBatches.erase(failed);
+      }
+      throw failure;
+    }
+  }
+}
+
 // lock the file according to the lock type
-void CSVHandler::lock(LockType lockType, LockOperation operation) {
+void CSVHandler::lock(LockType lockType, LockOperation operation,
+                      const char *site) {
   if (lockType == LockType::Mutex) {
-    fileMutex.mutexLockOn();
+    fileMutex.mutexLockFrom(
+        __builtin_extract_return_addr(__builtin_return_address(0)), site);
   } else if (lockType == LockType::RWLock) {
     if (operation == LockOperation::Write) {
       fileRWLock.writeLock();
@@ -64,33 +491,91 @@ void CSVHandler::unlock(LockType lockType, LockOperation operation) {
   }
 }
 
-// write a row from CSV file, file open in append mode
+// readers under Snapshot isolation take no lock at all
+bool CSVHandler::lockRead(const char *site) {
+  if (readIsolation == ReadIsolation::Snapshot) {
+    return false;
+  }
+  lock(lockType, LockOperation::Read, site);
+  return true;
+}
+
+void CSVHandler::unlockRead(bool locked) {
+  if (locked) {
+    unlock(lockType, LockOperation::Read);
+  }
+}
+
+// everything the row index covers is in the file: publish its end
+void CSVHandler::publishCommitted() {
+  committedBytes.store(rowIndex.getIndexedBytes(), memory_order_release);
+}
+
+// lock-free appends are not published by their writers, the index finds
+// their complete rows; this scan holds the row index mutex
+long CSVHandler::snapshotEnd() {
+  if (writeMode == WriteMode::AtomicAppend) {
+    rowIndex.catchUp(readFd);
+    return rowIndex.getIndexedBytes();
+  }
+  return committedBytes.load(memory_order_acquire);
+}
+
+// write a row to the CSV file, buffered according to the flush policy
 void CSVHandler::writeRow(const vector<string> &row) {
+  // formatted outside any lock into a buffer each thread reuses
+  thread_local string line;
+  line.clear();
+  formatRow(line, row);
+  writeLine(line);
+}
+
+// typed row, formatted without allocating once the buffers have grown
+void CSVHandler::writeRow(int id, string_view name, bool done) {
+  thread_local string line;
+  line.clear();
+  formatRow(line, id, name, done);
+  writeLine(line);
+}
+
+// write one formatted row according to the write mode and durability
+void CSVHandler::writeLine(string_view line) {
+  TraceScope trace("CSVHandler::writeRow", "csv");
   // start time for benchmarking
-  auto start = chrono::high_resolution_clock::now();
+  uint64_t start = CycleClock::now();
   //----------------------------------------------
 
-  lock(lockType, LockOperation::Write);
-  try {
-    // use a local stream to write the file
-    ofstream localStream(filePath, ios::out | ios::app);
-    if (!localStream.is_open()) {
-      unlock(lockType, LockOperation::Write);
-      throw runtime_error("Cannot open file: " + filePath);
-    }
-
-    for (size_t i = 0; i < row.size(); ++i) {
-      localStream << row[i];
-      if (i != row.size() - 1) {
-        localStream << ",";
+  if (writeMode == WriteMode::AtomicAppend ||
+      durability != Durability::None) {
+    try {
+      if (writeMode == WriteMode::AtomicAppend) {
+        appendRowUnlocked(line);
+      } else {
+        groupCommitRow(line); // join the next group commit
       }
+    } catch (const exception &e) {
+      cerr << "Error writing row to file: " << e.what() << endl;
+      throw;
     }
-    localStream << endl;
+    writeCount++;
+
+    long duration = CycleClock::now() - start;
+    totalWriteTime += duration;
+    maxWriteTime = max(maxWriteTime.load(), duration);
+    minWriteTime = min(minWriteTime.load(), duration);
+    return;
+  }
+
+  lock(lockType, LockOperation::Write, "CSVHandler::writeRow");
+  try {
+    // the descriptor stays open, the buffer keeps its capacity
+    writeBuffer += line;
+    bufferedRows++;
 
     writeCount++; // increment the write count
 
-    if (localStream.fail()) {
-      throw runtime_error("File write operation failed: " + filePath);
+    if (shouldFlush()) {
+      flushBuffer();
     }
 
   } catch (const exception &e) {
@@ -105,10 +590,8 @@ void CSVHandler::writeRow(const vector<string> &row) {
 
   unlock(lockType, LockOperation::Write); // unlock after successful operation
 
-  // Benchmark Tools, time calculation
-  auto end = chrono::high_resolution_clock::now();
-  long duration =
-      chrono::duration_cast<chrono::microseconds>(end - start).count();
+  // Benchmark Tools, time calculation in ticks
+  long duration = CycleClock::now() - start;
 
   totalWriteTime += duration;
   maxWriteTime = max(maxWriteTime.load(), duration);
@@ -116,74 +599,479 @@ void CSVHandler::writeRow(const vector<string> &row) {
   //----------------------------------------------
 }
 
+// write a batch of rows formatted by formatRow with one write(2), after any
+// rows still in the write buffer
+void CSVHandler::writeFormatted(const string &rows, int rowCount) {
+  TraceScope trace("CSVHandler::writeFormatted", "csv");
+  uint64_t start = CycleClock::now();
+
+  // lock-free appends are indexed by catchUp when they are read
+  bool locked = writeMode != WriteMode::AtomicAppend;
+  if (locked) {
+    lock(lockType, LockOperation::Write, "CSVHandler::writeFormatted");
+  }
+  try {
+    if (locked) {
+      flushBuffer();
+      writeLocked(rows.data(), rows.size());
+      publishCommitted();
+    } else {
+      writeFully(rows.data(), rows.size());
+    }
+    if (durability == Durability::FDataSync) {
+      uint64_t syncStart = CycleClock::now();
+      if (syncFileData(writeFd) != 0) {
+        throw runtime_error("fdatasync failed: " + filePath + ": " +
+                            strerror(errno));
+      }
+      syncLatencyHistogram.record(
+          CycleClock::toMicroseconds(CycleClock::now() - syncStart));
+    }
+  } catch (const exception &e) {
+    cerr << "Error writing rows to file: " << e.what() << endl;
+    if (locked) {
+      unlock(lockType, LockOperation::Write);
+    }
+    throw;
+  }
+  if (locked) {
+    unlock(lockType, LockOperation::Write);
+  }
+  writeCount += rowCount;
+  batchSizeHistogram.record(rowCount);
+
+  long duration = CycleClock::now() - start;
+  totalWriteTime += duration;
+  maxWriteTime = max(maxWriteTime.load(), duration);
+  minWriteTime = min(minWriteTime.load(), duration);
+}
+
 // read all from CSV file, file open in read mode
-vector<vector<string>> CSVHandler::readAll() {
+// Read all rows as an owning copy, kept for callers that need vectors
+vector<vector<string>> CSVHandler::readAll() { return readTable().toVectors(); }
+
+PmrRows CSVHandler::readAll(pmr::memory_resource *resource) {
+  return readTable().toVectors(resource);
+}
+
+// Read the whole file once and parse it into row views over the buffer
+CSVTable CSVHandler::readTable() { return readTableWith(nullptr); }
+
+// Read only matching rows and selected cells
+CSVTable CSVHandler::readTable(const CSVQuery &query) {
+  return readTableWith(&query);
+}
+
+CSVTable CSVHandler::readTableWith(const CSVQuery *query) {
+  TraceScope trace("CSVHandler::readTable", "csv");
   // Benchmark Tools, time calculation
-  auto start = chrono::high_resolution_clock::now();
+  uint64_t start = CycleClock::now();
   //----------------------------------------------
 
   // lock the file, enum LockOperation::Read
-  lock(lockType, LockOperation::Read);
-  vector<vector<string>> data;
+  bool locked = lockRead("CSVHandler::readTable");
+  CSVTable table;
+  // with lock-free appends the last line may still be in flight
+  bool completeRowsOnly = writeMode == WriteMode::AtomicAppend;
 
   try {
-    ifstream localStream(filePath); // use a local stream to read the file
-    if (!localStream.is_open()) {
-      throw runtime_error("Cannot open file: " + filePath);
+    if (!locked) {
+      table = readCommittedTable(query);
+    } else if (readMode == ReadMode::Mmap) {
+      // scan the mapped file in place, remapped only when it has grown
+      auto region = mappedFile->map();
+      table = CSVTable(region, string_view(region->data(), region->size()),
+                       completeRowsOnly, readThreads, query);
+    } else if (ring) {
+      struct stat fileStat;
+      if (fstat(readFd, &fileStat) != 0) {
+        throw runtime_error("Cannot stat file: " + filePath);
+      }
+      table = CSVTable(readBytes(0, fileStat.st_size), completeRowsOnly,
+                       readThreads, query);
+    } else {
+      ifstream localStream(filePath, ios::binary); // use a local stream
+      if (!localStream.is_open()) {
+        throw runtime_error("Cannot open file: " + filePath);
+      }
+
+      ostringstream buffer;
+      buffer << localStream.rdbuf(); // read the whole file in one pass
+      if (localStream.bad()) {
+        throw runtime_error("Error reading file: " + filePath);
+      }
+      table = CSVTable(buffer.str(), completeRowsOnly, readThreads, query);
     }
 
-    string line;
-    while (getline(localStream, line)) { // read line by line
-      vector<string> row;
-      stringstream lineStream(line);
-      string cell;
+    readCount++; // increment the read count
+
+    cout << "File read successfully. Total rows: " << table.rowCount()
+         << endl;
+
+  } catch (const exception &e) {
+    cerr << "Error during file read: " << e.what() << endl;
+    unlockRead(locked); // unlock the file
+    throw;
+  } catch (...) {
+    cerr << "Unknown error occurred during file read." << endl;
+    unlockRead(locked);
+    throw;
+  }
+
+  unlockRead(locked);
+
+  // Benchmark Tools, time calculation in ticks
+  long duration = CycleClock::now() - start;
+
+  totalReadTime += duration;
+  maxReadTime = max(maxReadTime.load(), duration);
+  minReadTime = min(minReadTime.load(), duration);
 
-      while (getline(lineStream, cell, ',')) {
-        row.push_back(cell);
+  //----------------------------------------------
+
+  return table;
+}
+
+// lock-free read of the rows up to the committed offset; a clear() that
+// truncates the file under the read restarts it in the new generation
+CSVTable CSVHandler::readCommittedTable(const CSVQuery *query) {
+  while (true) {
+    long generation = fileGeneration.load(memory_order_acquire);
+    long end = snapshotEnd();
+    if (readMode == ReadMode::Mmap) {
+      auto region = mappedFile->map();
+      size_t size = min(static_cast<size_t>(end), region->size());
+      return CSVTable(region, string_view(region->data(), size), false,
+                      readThreads, query);
+    }
+    try {
+      return CSVTable(readBytes(0, end), false, readThreads, query);
+    } catch (const runtime_error &) {
+      if (fileGeneration.load(memory_order_acquire) == generation) {
+        throw;
       }
-      data.push_back(row); // add the row to the data
+      snapshotRetries++;
     }
+  }
+}
 
-    readCount++; // increment the read count
+// rows in the index, lock-free unless lock-free appends must be scanned
+long CSVHandler::rowCount() {
+  if (writeMode == WriteMode::AtomicAppend) {
+    bool locked = lockRead("CSVHandler::rowCount");
+    try {
+      rowIndex.catchUp(readFd);
+    } catch (...) {
+      unlockRead(locked);
+      throw;
+    }
+    unlockRead(locked);
+  }
+  return rowIndex.getRowCount();
+}
+
+vector<string> CSVHandler::readRow(long i) {
+  CSVTable table = readRange(i, i + 1);
+  return table.row(0).toVector();
+}
+
+// read the rows [first, last) with one pread at their indexed offsets
+CSVTable CSVHandler::readRange(long first, long last) {
+  TraceScope trace("CSVHandler::readRange", "csv");
+  uint64_t start = CycleClock::now();
+
+  bool locked = lockRead("CSVHandler::readRange");
+  CSVTable table;
+
+  try {
+    if (writeMode == WriteMode::AtomicAppend) {
+      rowIndex.catchUp(readFd);
+    }
+    long begin;
+    long end;
+    if (!rowIndex.getRange(first, last, begin, end)) {
+      throw out_of_range("Rows [" + to_string(first) + ", " + to_string(last) +
+                         ") outside of " + to_string(rowIndex.getRowCount()) +
+                         " rows: " + filePath);
+    }
+
+    table = CSVTable(readBytes(begin, end));
+    readCount++;
+  } catch (const exception &e) {
+    cerr << "Error during file read: " << e.what() << endl;
+    unlockRead(locked);
+    throw;
+  }
+
+  unlockRead(locked);
+
+  long duration = CycleClock::now() - start;
+  totalReadTime += duration;
+  maxReadTime = max(maxReadTime.load(), duration);
+  minReadTime = min(minReadTime.load(), duration);
+
+  return table;
+}
 
-    if (localStream.fail() && !localStream.eof()) {
+// read [begin, end) of the file, the caller holds a file lock
+string CSVHandler::readBytes(long begin, long end) {
+  string buffer(end - begin, '\0');
+  if (ring) {
+    if (ring->readAll(readFd, &buffer[0], buffer.size(), begin) !=
+        buffer.size()) {
+      throw runtime_error("Error reading file: " + filePath);
+    }
+    return buffer;
+  }
+  size_t done = 0;
+  while (done < buffer.size()) {
+    ssize_t bytesRead =
+        pread(readFd, &buffer[done], buffer.size() - done, begin + done);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
       throw runtime_error("Error reading file: " + filePath);
     }
+    done += bytesRead;
+  }
+  return buffer;
+}
 
-    cout << "File read successfully. Total rows: " << data.size() << endl;
+// serve the cached snapshot, or build the next one (single-flight); under
+// Snapshot isolation it covers the committed rows and takes no file lock
+shared_ptr<const CSVSnapshot> CSVHandler::getSnapshot() {
+  TraceScope trace("CSVHandler::getSnapshot", "csv");
+  bool isolated = readIsolation == ReadIsolation::Snapshot;
+  // bytes the snapshot should cover now
+  auto currentEnd = [this, isolated]() {
+    return isolated ? snapshotEnd() : rowIndex.getIndexedBytes();
+  };
 
+  if (!isolated) {
+    rowCount(); // in AtomicAppend mode this indexes the newest appends
+  }
+  unique_lock<mutex> guard(snapshotMutex);
+  while (true) {
+    if (snapshot && snapshot->getGeneration() == fileGeneration.load() &&
+        snapshot->getByteSize() == currentEnd()) {
+      snapshotHits++;
+      return snapshot;
+    }
+    if (!snapshotBuilding) {
+      break;
+    }
+    snapshotCondition.wait(guard); // another reader is parsing this length
+  }
+  snapshotBuilding = true;
+  shared_ptr<const CSVSnapshot> base = snapshot;
+  guard.unlock();
+
+  shared_ptr<const CSVSnapshot> built;
+  bool locked = lockRead("CSVHandler::getSnapshot");
+  try {
+    while (!built) {
+      // generation and length are stable under the read lock; without it
+      // a clear() during the read shows as a new generation, and the read
+      // starts over
+      long generation = fileGeneration.load(memory_order_acquire);
+      long end = locked ? rowIndex.getIndexedBytes() : snapshotEnd();
+      bool extend = base && base->getGeneration() == generation &&
+                    base->getByteSize() <= end;
+      string bytes;
+      try {
+        bytes = readBytes(extend ? base->getByteSize() : 0, end);
+      } catch (const runtime_error &) {
+        if (locked ||
+            fileGeneration.load(memory_order_acquire) == generation) {
+          throw;
+        }
+      }
+      if (fileGeneration.load(memory_order_acquire) != generation) {
+        snapshotRetries++;
+        continue;
+      }
+      auto segment =
+          make_shared<const CSVTable>(move(bytes), false, readThreads);
+      if (extend) {
+        built = base->extend(segment, end);
+        snapshotExtensions++;
+      } else {
+        built = CSVSnapshot(generation).extend(segment, end);
+        snapshotRebuilds++;
+      }
+    }
+    readCount++;
   } catch (const exception &e) {
-    cerr << "Error during file read: " << e.what() << endl;
-    unlock(lockType, LockOperation::Read); // unlock the file
+    cerr << "Error building snapshot: " << e.what() << endl;
+    unlockRead(locked);
+    guard.lock();
+    snapshotBuilding = false;
+    snapshotCondition.notify_all();
     throw;
+  }
+  unlockRead(locked);
+
+  guard.lock();
+  snapshot = built;
+  snapshotBuilding = false;
+  snapshotCondition.notify_all();
+  return built;
+}
+
+// rebuild the row index from the file contents, e.g. after an external edit
+void CSVHandler::rebuildIndex() {
+  lock(lockType, LockOperation::Write, "CSVHandler::rebuildIndex");
+  try {
+    rowIndex.rebuild(readFd);
+    publishCommitted();
   } catch (...) {
-    cerr << "Unknown error occurred during file read." << endl;
-    unlock(lockType, LockOperation::Read);
+    unlock(lockType, LockOperation::Write);
     throw;
   }
+  unlock(lockType, LockOperation::Write);
+}
 
-  unlock(lockType, LockOperation::Read);
+// stream the file row by row, memory is bounded by the reader's buffer
+long CSVHandler::forEachRow(const function<bool(const CSVRow &)> &callback) {
+  return forEachRowWith(nullptr, callback);
+}
 
-  // Benchmark Tools, time calculation
-  auto end = chrono::high_resolution_clock::now();
-  long duration =
-      chrono::duration_cast<chrono::microseconds>(end - start).count();
+// stream only the matching rows
+long CSVHandler::forEachRow(const CSVQuery &query,
+                            const function<bool(const CSVRow &)> &callback) {
+  return forEachRowWith(&query, callback);
+}
+
+long CSVHandler::forEachRowWith(
+    const CSVQuery *query, const function<bool(const CSVRow &)> &callback) {
+  TraceScope trace("CSVHandler::forEachRow", "csv");
+  uint64_t start = CycleClock::now();
 
+  bool locked = lockRead("CSVHandler::forEachRow");
+  long rowsVisited = 0;
+
+  try {
+    // without the lock only the committed rows are read: a group-commit
+    // batch may be in the file before it is synced, or fail afterwards
+    CSVRowReader reader(filePath, CSVRowReader::kDefaultBufferSize,
+                        writeMode == WriteMode::AtomicAppend || !locked,
+                        query, locked ? -1 : snapshotEnd());
+    CSVRow row;
+    while (reader.next(row)) {
+      rowsVisited++;
+      if (!callback(row)) {
+        break; // the caller found what it needed
+      }
+    }
+    readCount++;
+  } catch (const exception &e) {
+    cerr << "Error during file read: " << e.what() << endl;
+    unlockRead(locked);
+    throw;
+  }
+
+  unlockRead(locked);
+
+  long duration = CycleClock::now() - start;
   totalReadTime += duration;
   maxReadTime = max(maxReadTime.load(), duration);
   minReadTime = min(minReadTime.load(), duration);
 
-  //----------------------------------------------
+  return rowsVisited;
+}
+
+// pull-style reader, rows with an append in flight are skipped like readAll;
+// snapshot-isolated readers stop at the committed offset
+CSVRowReader CSVHandler::openRowReader(size_t bufferSize) {
+  bool snapshot = readIsolation == ReadIsolation::Snapshot;
+  return CSVRowReader(filePath, bufferSize,
+                      writeMode == WriteMode::AtomicAppend, nullptr,
+                      snapshot ? snapshotEnd() : -1);
+}
+
+// read the complete rows appended after the cursor, file open in read mode
+vector<vector<string>> CSVHandler::readSince(CSVCursor &cursor) {
+  TraceScope trace("CSVHandler::readSince", "csv");
+  uint64_t start = CycleClock::now();
+
+  bool locked = lockRead("CSVHandler::readSince");
+  vector<vector<string>> data;
+
+  try {
+    while (true) {
+      long generation = fileGeneration.load(memory_order_acquire);
+      if (cursor.generation != generation) {
+        cursor = CSVCursor(); // cleared since the last call, start over
+        cursor.generation = generation;
+      }
+
+      ifstream localStream(filePath, ios::binary);
+      if (!localStream.is_open()) {
+        throw runtime_error("Cannot open file: " + filePath);
+      }
+      localStream.seekg(0, ios::end);
+      long fileSize = localStream.tellg();
+      if (!locked) {
+        fileSize = min(fileSize, snapshotEnd()); // only committed rows
+      }
+      if (fileSize < cursor.offset) {
+        cursor = CSVCursor(); // truncated outside this handler
+        cursor.generation = generation;
+      }
+
+      // only the bytes appended since the last call are read
+      string tail(fileSize - cursor.offset, '\0');
+      localStream.seekg(cursor.offset, ios::beg);
+      localStream.read(&tail[0], tail.size());
+      if (!locked &&
+          fileGeneration.load(memory_order_acquire) != generation) {
+        snapshotRetries++; // cleared while reading, the bytes are stale
+        continue;
+      }
+      if (localStream.gcount() != static_cast<streamsize>(tail.size())) {
+        throw runtime_error("Error reading file: " + filePath);
+      }
+
+      // a trailing partial row stays behind the cursor until it is complete
+      CSVTable rows(move(tail), true);
+      data = rows.toVectors();
+      cursor.offset += rows.parsedSize();
+      cursor.rowsRead += data.size();
+      break;
+    }
+
+    readCount++;
+  } catch (const exception &e) {
+    cerr << "Error during file read: " << e.what() << endl;
+    unlockRead(locked);
+    throw;
+  }
+
+  unlockRead(locked);
+
+  long duration = CycleClock::now() - start;
+  totalReadTime += duration;
+  maxReadTime = max(maxReadTime.load(), duration);
+  minReadTime = min(minReadTime.load(), duration);
 
   return data;
 }
 
 // Clear the CSV file
 void CSVHandler::clear() {
+  TraceScope trace("CSVHandler::clear", "csv");
   // Apply write lock
-  lock(lockType, LockOperation::Write);
+  lock(lockType, LockOperation::Write, "CSVHandler::clear");
 
   try {
+    // Drop rows that were never written
+    writeBuffer.clear();
+    bufferedRows = 0;
+    directOffset = 0;
+    directStaged = 0;
+    directWritten = 0;
+
     // Ensure the file stream is closed before reopening
     if (fileStream.is_open()) {
       fileStream.close();
@@ -192,11 +1080,17 @@ void CSVHandler::clear() {
       }
     }
 
+    // lock-free readers stop at offset 0 from here on, and a read cut
+    // short by the truncation sees the new generation and restarts
+    committedBytes.store(0, memory_order_release);
+    fileGeneration++; // cached snapshots no longer describe the file
+
     // Open the file in truncation mode to clear its content
     fileStream.open(filePath, ios::out | ios::trunc);
     if (!fileStream.is_open()) {
       throw runtime_error("Cannot open file in truncation mode: " + filePath);
     }
+    rowIndex.reset();
 
     // Successfully cleared the file
     cout << "CSV file cleared successfully." << endl;
@@ -217,7 +1111,7 @@ void CSVHandler::clear() {
 
 // reset the file pointer
 void CSVHandler::resetStream() {
-  lock(lockType, LockOperation::Read);
+  lock(lockType, LockOperation::Read, "CSVHandler::resetStream");
   try {
     if (!fileStream.is_open()) {
       fileStream.open(filePath, ios::in); // open the file in read mode
@@ -236,6 +1130,210 @@ void CSVHandler::resetStream() {
   unlock(lockType, LockOperation::Read);
 }
 
+// set when buffered rows are written out, flushes what is already buffered
+void CSVHandler::setFlushPolicy(FlushPolicy policy, long threshold) {
+  if (policy != FlushPolicy::PerRow && policy != FlushPolicy::OnClose &&
+      threshold <= 0) {
+    throw invalid_argument("Flush threshold must be positive.");
+  }
+  stopIntervalFlusher(); // it takes the write lock
+  lock(lockType, LockOperation::Write, "CSVHandler::setFlushPolicy");
+  try {
+    flushBuffer();
+  } catch (...) {
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  flushPolicy = policy;
+  flushThreshold = threshold;
+  unlock(lockType, LockOperation::Write);
+  if (policy == FlushPolicy::Interval) {
+    startIntervalFlusher();
+  }
+}
+
+FlushPolicy CSVHandler::getFlushPolicy() const { return flushPolicy; }
+
+// write out all buffered rows
+void CSVHandler::flush() {
+  lock(lockType, LockOperation::Write, "CSVHandler::flush");
+  try {
+    flushBuffer();
+    writeDirectTail();
+  } catch (...) {
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  unlock(lockType, LockOperation::Write);
+}
+
+// set the durability level, rows buffered so far are written out first
+void CSVHandler::setDurability(Durability level) {
+  flush();
+  durability = level;
+}
+
+Durability CSVHandler::getDurability() const { return durability; }
+
+// set the write mode, rows buffered so far are written out first
+void CSVHandler::setWriteMode(WriteMode mode) {
+  flush();
+  if (writeMode == WriteMode::AtomicAppend) {
+    rowIndex.catchUp(readFd); // writeRow indexes its own rows from here on
+    publishCommitted();
+  }
+  writeMode = mode;
+}
+
+WriteMode CSVHandler::getWriteMode() const { return writeMode; }
+
+// set how readAll reads the file, the mapping is created lazily
+void CSVHandler::setReadMode(ReadMode mode) {
+  lock(lockType, LockOperation::Write, "CSVHandler::setReadMode");
+  try {
+    // created here, concurrent readers never race to create it
+    if (mode == ReadMode::Mmap && !mappedFile) {
+      mappedFile = make_unique<MappedFile>(filePath);
+    }
+  } catch (...) {
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  readMode = mode;
+  unlock(lockType, LockOperation::Write);
+}
+
+ReadMode CSVHandler::getReadMode() const { return readMode; }
+
+// switch read isolation; readers already in flight finish the old way
+void CSVHandler::setReadIsolation(ReadIsolation isolation) {
+  lock(lockType, LockOperation::Write, "CSVHandler::setReadIsolation");
+  readIsolation = isolation;
+  unlock(lockType, LockOperation::Write);
+}
+
+ReadIsolation CSVHandler::getReadIsolation() const { return readIsolation; }
+
+long CSVHandler::getCommittedBytes() const {
+  return committedBytes.load(memory_order_acquire);
+}
+
+long CSVHandler::getSnapshotRetries() const { return snapshotRetries.load(); }
+
+// release the io_uring or O_DIRECT resources, the caller holds the write
+// lock (or is the destructor)
+void CSVHandler::closeIOBackend() {
+  ring.reset();
+  if (directFd >= 0) {
+    ::close(directFd);
+    directFd = -1;
+  }
+  directBuffer.reset();
+  directOffset = 0;
+  directStaged = 0;
+  directWritten = 0;
+  if (positionalWriteFd >= 0) {
+    ::close(positionalWriteFd);
+    positionalWriteFd = -1;
+  }
+  ioBackend = IOBackend::Sync;
+}
+
+// switch the I/O backend, stay on Sync if the new one cannot be set up
+void CSVHandler::setIOBackend(IOBackend backend) {
+  lock(lockType, LockOperation::Write, "CSVHandler::setIOBackend");
+  try {
+    if (backend != ioBackend) {
+      flushBuffer();
+      writeDirectTail();
+      closeIOBackend();
+    }
+    if (backend != ioBackend && backend == IOBackend::Uring &&
+        !IOUring::isSupported()) {
+      cerr << "io_uring is not available, keeping synchronous I/O for "
+           << filePath << endl;
+    } else if (backend != ioBackend) {
+      positionalWriteFd = open(filePath.c_str(), O_WRONLY | O_CLOEXEC);
+      if (positionalWriteFd < 0) {
+        throw runtime_error("Cannot open file for writing: " + filePath);
+      }
+      if (backend == IOBackend::Uring) {
+        try {
+          ring = make_unique<IOUring>();
+          ioBackend = IOBackend::Uring;
+        } catch (const runtime_error &e) {
+          cerr << e.what() << ", keeping synchronous I/O for " << filePath
+               << endl;
+        }
+      } else {
+        void *buffer = nullptr;
+#if defined(O_DIRECT)
+        directFd = open(filePath.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+#else
+        errno = EINVAL;
+#endif
+        if (directFd < 0) {
+          cerr << "O_DIRECT is not supported here (" << strerror(errno)
+               << "), keeping buffered I/O for " << filePath << endl;
+        } else if (posix_memalign(&buffer, kDirectAlignment,
+                                  kDirectBufferSize) != 0) {
+          throw runtime_error("Cannot allocate the O_DIRECT buffer.");
+        } else {
+          directBuffer.reset(static_cast<char *>(buffer));
+          ioBackend = IOBackend::Direct;
+        }
+      }
+      if (ioBackend == IOBackend::Sync) {
+        closeIOBackend();
+      }
+    }
+  } catch (...) {
+    closeIOBackend();
+    unlock(lockType, LockOperation::Write);
+    throw;
+  }
+  unlock(lockType, LockOperation::Write);
+}
+
+IOBackend CSVHandler::getIOBackend() const { return ioBackend; }
+
+long CSVHandler::getDirectBytes() const { return directBytes.load(); }
+
+long CSVHandler::getBufferedBytes() const { return bufferedBytes.load(); }
+
+// set how many threads parse one read, large files are split into chunks
+void CSVHandler::setReadThreads(int threads) {
+  if (threads < 1) {
+    throw invalid_argument("Read threads must be at least 1.");
+  }
+  lock(lockType, LockOperation::Write, "CSVHandler::setReadThreads");
+  readThreads = threads;
+  unlock(lockType, LockOperation::Write);
+}
+
+int CSVHandler::getReadThreads() const { return readThreads; }
+
+const Histogram &CSVHandler::getBatchSizeHistogram() const {
+  return batchSizeHistogram;
+}
+
+const Histogram &CSVHandler::getSyncLatencyHistogram() const {
+  return syncLatencyHistogram;
+}
+
+long CSVHandler::getSnapshotHits() const { return snapshotHits.load(); }
+
+long CSVHandler::getSnapshotExtensions() const {
+  return snapshotExtensions.load();
+}
+
+long CSVHandler::getSnapshotRebuilds() const { return snapshotRebuilds.load(); }
+
+void CSVHandler::resetCommitStatistics() {
+  batchSizeHistogram.reset();
+  syncLatencyHistogram.reset();
+}
+
 // close the stream
 void CSVHandler::closeStream() {
   if (fileStream.is_open()) {
@@ -244,14 +1342,32 @@ void CSVHandler::closeStream() {
   }
 }
 
-// Getters for benchmark statistics
+// Getters for benchmark statistics, ticks are converted to us only here
 // ----------------------------------------------
-long CSVHandler::getTotalWriteTime() const { return totalWriteTime; }
-long CSVHandler::getTotalReadTime() const { return totalReadTime; }
-long CSVHandler::getMaxWriteTime() const { return maxWriteTime; }
-long CSVHandler::getMinWriteTime() const { return minWriteTime; }
-long CSVHandler::getMaxReadTime() const { return maxReadTime; }
-long CSVHandler::getMinReadTime() const { return minReadTime; }
+namespace {
+long ticksToMicroseconds(long ticks) {
+  return ticks == LONG_MAX ? LONG_MAX : CycleClock::toMicroseconds(ticks);
+}
+} // namespace
+
+long CSVHandler::getTotalWriteTime() const {
+  return ticksToMicroseconds(totalWriteTime);
+}
+long CSVHandler::getTotalReadTime() const {
+  return ticksToMicroseconds(totalReadTime);
+}
+long CSVHandler::getMaxWriteTime() const {
+  return ticksToMicroseconds(maxWriteTime);
+}
+long CSVHandler::getMinWriteTime() const {
+  return ticksToMicroseconds(minWriteTime);
+}
+long CSVHandler::getMaxReadTime() const {
+  return ticksToMicroseconds(maxReadTime);
+}
+long CSVHandler::getMinReadTime() const {
+  return ticksToMicroseconds(minReadTime);
+}
 int CSVHandler::getWriteCount() const { return writeCount; }
 int CSVHandler::getReadCount() const { return readCount; }
 
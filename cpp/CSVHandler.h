@@ -1,20 +1,86 @@
 #ifndef CSVHANDLER_H
 #define CSVHANDLER_H
 
+#include "util/Histogram.h"
+#include "util/IOUring.h"
+#include "util/CSVRowReader.h"
+#include "util/CSVSnapshot.h"
+#include "util/CSVTable.h"
 #include "util/LockType.h"
+#include "util/MappedFile.h"
 #include "util/MutexLock.h"
 #include "util/RWLock.h"
+#include "util/RowIndex.h"
 #include <atomic>
 #include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 enum class LockOperation { Read, Write };
 
+// When rows buffered by writeRow reach the file (and become visible to readers)
+enum class FlushPolicy {
+  PerRow,      // write every row immediately (default)
+  EveryNRows,  // once threshold rows are buffered
+  EveryNBytes, // once threshold bytes are buffered
+  Interval,    // at most threshold ms after the last flush, also when writes
+               // stop: a background thread flushes the idle buffer
+  OnClose      // only on flush() or destruction
+};
+
+// How writeRow serializes writers
+enum class WriteMode {
+  Locked,      // writers take the file lock (buffered or group commit)
+  AtomicAppend // no user-space lock: one write(2) per row on O_APPEND
+};
+
+// How readAll/readTable get the file contents
+enum class ReadMode {
+  Stream, // read the file into a heap buffer through an ifstream
+  Mmap    // map the file read-only and scan it in place
+};
+
+// How readers synchronize with writers
+enum class ReadIsolation {
+  Locked,  // readers take the read lock, writers wait for them (default)
+  Snapshot // no lock: readers see the rows up to the committed offset that
+           // writers publish after each row or batch
+};
+
+// Which system calls move the bytes of locked writes and Stream/indexed reads
+enum class IOBackend {
+  Sync, // write(2)/pread(2) on the calling thread (default)
+  Uring, // io_uring: the chunks of one write or read are in flight together,
+         // the call still waits for all of them under the write lock
+  Direct  // O_DIRECT writes of whole aligned blocks, bypassing the page cache
+};
+
+// What writeRow guarantees before it returns
+enum class Durability {
+  None,     // row may sit in the user-space buffer (see FlushPolicy)
+  Flush,    // row was written to the kernel, group-committed with others
+  FDataSync // row was written and fdatasync'ed, group-committed with others
+};
+
+// Per-reader position for CSVHandler::readSince
+struct CSVCursor {
+  long offset = 0;     // byte offset just past the last complete row read
+  long rowsRead = 0;   // rows returned through this cursor so far
+  long generation = 0; // clear() count of the handler the offset is for
+};
+
 class CSVHandler {
 private:
   std::string filePath;    // File path for CSV
@@ -23,25 +89,132 @@ private:
   RWLock fileRWLock;       // Read-write lock for file operations
   std::fstream fileStream; // File stream for reading and writing
 
-  // Benchmark statistics
+  // Persistent write path, guarded by the write lock
+  int writeFd = -1;        // long-lived O_APPEND descriptor used by writeRow
+  int readFd = -1;         // read-only descriptor for indexed reads
+  RowIndex rowIndex;       // start offset of every complete row
+  std::string writeBuffer; // formatted rows not yet written to the file
+  int bufferedRows = 0;    // rows in writeBuffer
+  FlushPolicy flushPolicy = FlushPolicy::PerRow;
+  long flushThreshold = 0;     // rows, bytes or ms depending on the policy
+  uint64_t lastFlushTicks = 0; // CycleClock ticks of the last flush
+
+  // Interval policy: flushes rows left in writeBuffer once writes stop
+  std::thread intervalFlusher;
+  std::mutex intervalMutex;
+  std::condition_variable intervalCondition;
+  bool intervalStopping = false;
+
+  WriteMode writeMode = WriteMode::Locked;
+  ReadMode readMode = ReadMode::Stream;
+  std::atomic<ReadIsolation> readIsolation{ReadIsolation::Locked};
+  // end of the last complete row written under the lock, stored with
+  // release order once the bytes are in the file
+  std::atomic<long> committedBytes{0};
+  std::atomic<long> snapshotRetries{0}; // reads restarted by clear()
+  int readThreads = 1; // parser threads per readTable
+  std::unique_ptr<MappedFile> mappedFile; // created on first Mmap read
+
+  IOBackend ioBackend = IOBackend::Sync;
+  std::unique_ptr<IOUring> ring; // created by setIOBackend(Uring)
+  int positionalWriteFd = -1;    // Uring/Direct, O_APPEND would reorder
+
+  // Direct: rows are staged in an aligned buffer and written as whole
+  // blocks. The partial last block stays staged, its rows unseen by
+  // readers, until it fills; flush() and close write it zero padded with
+  // O_DIRECT and truncate the padding off.
+  static const size_t kDirectAlignment = 4096;
+  static const size_t kDirectBufferSize = 1 << 20;
+  int directFd = -1;
+  std::unique_ptr<char, void (*)(void *)> directBuffer{nullptr, free};
+  size_t directOffset = 0; // aligned file offset of directBuffer[0]
+  size_t directStaged = 0;  // bytes in directBuffer
+  size_t directWritten = 0; // leading staged bytes already in the file
+  std::atomic<long> directBytes{0};   // written with O_DIRECT
+  std::atomic<long> bufferedBytes{0}; // after O_DIRECT was rejected
+
+  // Group commit: writers queue rows into a shared batch, one leader writes
+  // (and syncs) the whole batch, then releases every writer in it
+  Durability durability = Durability::None;
+  std::mutex commitMutex;
+  std::condition_variable commitCondition;
+  std::string commitBatch;     // rows waiting for the next leader
+  int commitBatchRows = 0;     // rows in commitBatch
+  uint64_t enqueuedSeq = 0;    // sequence number of the last queued row
+  uint64_t resolvedSeq = 0;    // rows up to here were committed or failed
+  bool commitLeaderActive = false;
+  // rows in (begin, end] failed to commit; kept until every writer of the
+  // batch has seen it, later failures may land before they wake up
+  struct FailedBatch {
+    uint64_t begin;
+    uint64_t end;
+    std::string error;
+    uint64_t unreported; // writers of the batch that have not thrown yet
+  };
+  std::vector<FailedBatch> failedBatches;
+  Histogram batchSizeHistogram;     // rows per committed batch
+  Histogram syncLatencyHistogram;   // fdatasync latency (us)
+
+  // Shared parsed snapshot: one builder at a time, the others wait for it
+  std::mutex snapshotMutex;
+  std::condition_variable snapshotCondition;
+  std::shared_ptr<const CSVSnapshot> snapshot; // latest published snapshot
+  bool snapshotBuilding = false;
+  std::atomic<long> fileGeneration{0}; // bumped by clear()
+  std::atomic<long> snapshotHits{0};       // served without parsing
+  std::atomic<long> snapshotExtensions{0}; // only new bytes parsed
+  std::atomic<long> snapshotRebuilds{0};   // whole file parsed
+
+  // Benchmark statistics, times are CycleClock ticks, getters return us
   std::atomic<long> totalWriteTime{
-      0}; // Total time spent on write operations (us)
+      0}; // Total time spent on write operations
   std::atomic<long> totalReadTime{
-      0}; // Total time spent on read operations (us)
+      0}; // Total time spent on read operations
   std::atomic<long> maxWriteTime{
-      0}; // Maximum time spent on a single write operation (us)
+      0}; // Maximum time spent on a single write operation
   std::atomic<long> minWriteTime{
-      LONG_MAX}; // Minimum time spent on a single write operation (us)
+      LONG_MAX}; // Minimum time spent on a single write operation
   std::atomic<long> maxReadTime{
-      0}; // Maximum time spent on a single read operation (us)
+      0}; // Maximum time spent on a single read operation
   std::atomic<long> minReadTime{
-      LONG_MAX}; // Minimum time spent on a single read operation (us)
+      LONG_MAX}; // Minimum time spent on a single read operation
   std::atomic<int> writeCount{0}; // Number of write operations
   std::atomic<int> readCount{0};  // Number of read operations
 
-  // Lock and unlock helpers
-  void lock(LockType lockType, LockOperation operation);
+  // Buffered write helpers, caller holds the write lock
+  bool shouldFlush() const;
+  void flushBuffer();
+  void writeFully(const char *data, size_t size);
+  void writeLocked(const char *data, size_t size); // at the end of the file
+  void writeDirect(const char *data, size_t size);
+  void writeDirectTail();
+  void closeIOBackend();
+  void groupCommitRow(std::string_view line);
+  void appendRowUnlocked(std::string_view line);
+  void writeLine(std::string_view line); // shared tail of the writeRows
+  void startIntervalFlusher();
+  void stopIntervalFlusher();
+  void runIntervalFlusher(); // body of intervalFlusher
+
+  // Lock and unlock helpers, site tags the acquisition for LockProfiler;
+  // untagged callers are keyed by their return address
+  void lock(LockType lockType, LockOperation operation,
+            const char *site = nullptr);
   void unlock(LockType lockType, LockOperation operation);
+  // read lock unless reads are snapshot-isolated; returns whether it locked
+  bool lockRead(const char *site);
+  void unlockRead(bool locked);
+  void publishCommitted(); // caller holds the write lock
+  long snapshotEnd();      // committed offset a lock-free reader stops at
+
+  // read file bytes [begin, end) through readFd
+  std::string readBytes(long begin, long end);
+
+  // Read paths shared by the plain and the filtered overloads
+  CSVTable readTableWith(const CSVQuery *query);
+  CSVTable readCommittedTable(const CSVQuery *query); // Snapshot, no lock
+  long forEachRowWith(const CSVQuery *query,
+                      const std::function<bool(const CSVRow &)> &callback);
 
 public:
   // Constructor and destructor
@@ -54,10 +227,112 @@ public:
 
   // Core functionalities for CSV handling
   void writeRow(const std::vector<std::string> &row); // Write a row to the CSV
+  // Write a task row (id, name, Complete/Incomplete) without building a
+  // vector<string>: no allocation per row once the buffers have grown
+  void writeRow(int id, std::string_view name, bool done);
+  // Append one row as a CSV line (with its newline) to out
+  static void formatRow(std::string &out, const std::vector<std::string> &row);
+  static void formatRow(std::string &out, const CSVRow &row);
+  static void formatRow(std::string &out, int id, std::string_view name,
+                        bool done);
+  // Write rows already formatted by formatRow with one write, behind any
+  // buffered rows; synced under FDataSync, counted in the batch histogram
+  void writeFormatted(const std::string &rows, int rowCount);
   std::vector<std::vector<std::string>> readAll(); // Read all rows from the CSV
+  // Read all rows into memory from resource, e.g. a monotonic buffer per
+  // reader that is released at once when the rows are no longer needed
+  PmrRows readAll(std::pmr::memory_resource *resource);
+  // Read all rows as views into one buffer, no per-cell allocation. A table
+  // read in Mmap mode must not be used after clear() truncates the file.
+  CSVTable readTable();
+  // Only the rows matching the query, with only its selected cells; rows
+  // are rejected during the scan, unneeded cells are never materialized
+  CSVTable readTable(const CSVQuery &query);
+  // Stream the rows through a fixed-size buffer under the read lock; the
+  // callback returns false to stop early and must not write to this
+  // handler. Returns the number of rows visited.
+  long forEachRow(const std::function<bool(const CSVRow &)> &callback);
+  long forEachRow(const CSVQuery &query,
+                  const std::function<bool(const CSVRow &)> &callback);
+  // Pull-style reader over the file, takes no lock: it sees complete rows
+  // appended until it reaches them. Under Snapshot isolation it stops at
+  // the committed offset as of opening.
+  CSVRowReader
+  openRowReader(size_t bufferSize = CSVRowReader::kDefaultBufferSize);
+  // Read only the complete rows appended since the cursor, then advance it;
+  // clear() restarts the cursor at the beginning, even if the file has
+  // grown past the old offset again, as does a file truncated elsewhere
+  std::vector<std::vector<std::string>> readSince(CSVCursor &cursor);
+  // Number of complete rows, O(1) from the row index (in AtomicAppend mode
+  // the index first scans the bytes appended since the last call)
+  long rowCount();
+  // Row i, or rows [first, last), read directly at their indexed offsets;
+  // throw out_of_range past rowCount()
+  std::vector<std::string> readRow(long i);
+  CSVTable readRange(long first, long last);
+  // Rebuild the row index with a newline scan of the whole file
+  void rebuildIndex();
+  // Shared immutable snapshot of every complete row. Readers of the same
+  // file length share one parse (concurrent requests wait for a single
+  // builder); later appends extend the previous snapshot with only the new
+  // bytes, clear() starts a new generation. Under Snapshot isolation it
+  // covers the committed rows and is refreshed without the read lock.
+  std::shared_ptr<const CSVSnapshot> getSnapshot();
   void clear();       // Clear the content of the CSV file
   void resetStream(); // Reset the file stream pointer
   void closeStream(); // Close the file stream
+
+  // Write buffering, see FlushPolicy
+  void setFlushPolicy(FlushPolicy policy, long threshold = 0);
+  FlushPolicy getFlushPolicy() const;
+  void flush(); // write out all buffered rows now
+
+  // Write mode, call before writers start. AtomicAppend relies on the
+  // kernel's atomic O_APPEND writes to regular files and ignores the flush
+  // policy: every row is written at once (and synced under FDataSync).
+  // Local filesystems write a regular-file row whole unless the disk is
+  // full or the size limit is reached; writeRow then throws rather than
+  // finishing the row with a second write another row could split.
+  void setWriteMode(WriteMode mode);
+  WriteMode getWriteMode() const;
+
+  // Read mode used by readAll/readTable
+  void setReadMode(ReadMode mode);
+  ReadMode getReadMode() const;
+  // Read isolation, see ReadIsolation. Snapshot applies to readAll,
+  // readTable, forEachRow, openRowReader, readRange/readRow, rowCount,
+  // readSince and getSnapshot; clear() concurrent with a Mmap snapshot read
+  // is not supported. With AtomicAppend writers nobody publishes the committed
+  // offset, so each snapshot read first scans new rows into the row index
+  // under its mutex: those readers serialize on that scan, not lock-free.
+  void setReadIsolation(ReadIsolation isolation);
+  ReadIsolation getReadIsolation() const;
+  long getCommittedBytes() const;
+  long getSnapshotRetries() const;
+  // Threads used to parse one readAll/readTable, 1 parses serially
+  void setReadThreads(int threads);
+  int getReadThreads() const;
+
+  // I/O backend, falls back to Sync (with a warning) when the kernel has
+  // no io_uring or the filesystem rejects O_DIRECT. Lock-free appends
+  // (AtomicAppend) always use write(2).
+  void setIOBackend(IOBackend backend);
+  IOBackend getIOBackend() const;
+  // Direct backend: bytes written as whole blocks vs through the page cache
+  long getDirectBytes() const;
+  long getBufferedBytes() const;
+
+  // Durability, call before writers start; Flush and FDataSync group-commit
+  void setDurability(Durability level);
+  Durability getDurability() const;
+  const Histogram &getBatchSizeHistogram() const;
+  const Histogram &getSyncLatencyHistogram() const;
+  void resetCommitStatistics();
+
+  // Snapshot cache statistics
+  long getSnapshotHits() const;
+  long getSnapshotExtensions() const;
+  long getSnapshotRebuilds() const;
   //----------------------------------------------
 
   // Getters for benchmark statistics
@@ -0,0 +1,239 @@
+#include "MappedCSVWriter.h"
+#include "CSVHandler.h"
+#include "util/TraceRecorder.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const uint64_t kCommitMagic = 0x31544d43; // "CMT1"
+const size_t kHeaderSize = 4096;
+
+string errnoMessage(const string &what, const string &path) {
+  return what + " " + path + ": " + strerror(errno);
+}
+
+// extend the file to length, allocating the blocks up front
+void allocate(int fd, size_t from, size_t length) {
+#if defined(__linux__)
+  if (fallocate(fd, 0, from, length - from) == 0) {
+    return;
+  }
+  if (errno != EOPNOTSUPP) {
+    throw runtime_error(string("fallocate failed: ") + strerror(errno));
+  }
+#endif
+  // filesystem without fallocate: a sparse extension still avoids growing
+  // the file on every append
+  if (ftruncate(fd, length) != 0) {
+    throw runtime_error(string("ftruncate failed: ") + strerror(errno));
+  }
+}
+
+} // namespace
+
+// the first page of <path>.commit; committed only grows
+struct MappedCSVWriter::CommitHeader {
+  uint64_t magic;
+  uint64_t committed;
+  uint64_t reserved;
+};
+
+struct MappedCSVWriter::Window {
+  char *data = nullptr;
+  size_t size = 0;
+
+  Window(int fd, size_t size) : size(size) {
+    void *address =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+      throw runtime_error(string("mmap failed: ") + strerror(errno));
+    }
+    data = static_cast<char *>(address);
+  }
+  ~Window() { munmap(data, size); }
+
+  Window(const Window &) = delete;
+  Window &operator=(const Window &) = delete;
+};
+
+MappedCSVWriter::MappedCSVWriter(const string &path, size_t extentSize,
+                                 size_t maxFileSize)
+    : filePath(path), headerPath(path + ".commit"), extentSize(extentSize),
+      maxFileSize(maxFileSize) {
+  if (extentSize == 0 || maxFileSize < extentSize) {
+    throw invalid_argument("Extent size must be positive and fit the "
+                           "maximum file size.");
+  }
+  fd = open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw runtime_error(errnoMessage("Cannot open", filePath));
+  }
+  headerFd =
+      open(headerPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (headerFd < 0) {
+    ::close(fd);
+    throw runtime_error(errnoMessage("Cannot open", headerPath));
+  }
+  try {
+    allocate(headerFd, 0, kHeaderSize);
+    void *address = mmap(nullptr, kHeaderSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, headerFd, 0);
+    if (address == MAP_FAILED) {
+      throw runtime_error(string("mmap failed: ") + strerror(errno));
+    }
+    header = static_cast<CommitHeader *>(address);
+    header->magic = kCommitMagic;
+    // the whole window is mapped up front: pages past the end of the file
+    // are never touched, and growing the file never moves a row
+    window = make_shared<Window>(fd, maxFileSize);
+    lock_guard<mutex> lock(appendMutex);
+    reserve(extentSize);
+  } catch (...) {
+    if (header != nullptr) {
+      munmap(header, kHeaderSize);
+    }
+    ::close(fd);
+    ::close(headerFd);
+    throw;
+  }
+}
+
+MappedCSVWriter::~MappedCSVWriter() {
+  try {
+    close();
+  } catch (const exception &e) {
+    cerr << "MappedCSVWriter close failed: " << e.what() << endl;
+  }
+  munmap(header, kHeaderSize);
+}
+
+// allocate whole extents until length bytes fit
+void MappedCSVWriter::reserve(size_t length) {
+  if (length <= reserved) {
+    return;
+  }
+  if (length > maxFileSize) {
+    throw runtime_error("Mapped CSV file " + filePath +
+                        " is full: " + to_string(maxFileSize) + " bytes.");
+  }
+  TraceScope trace("MappedCSVWriter::reserve", "csv");
+  size_t target = (length + extentSize - 1) / extentSize * extentSize;
+  target = min(target, maxFileSize);
+  allocate(fd, reserved, target);
+  reserved = target;
+  __atomic_store_n(&header->reserved, reserved, __ATOMIC_RELEASE);
+  extentCount++;
+}
+
+void MappedCSVWriter::append(const char *data, size_t size) {
+  lock_guard<mutex> lock(appendMutex);
+  if (closed) {
+    throw runtime_error("Mapped CSV file " + filePath + " is closed.");
+  }
+  size_t committed = __atomic_load_n(&header->committed, __ATOMIC_RELAXED);
+  reserve(committed + size);
+  memcpy(window->data + committed, data, size);
+  // readers that see the new length also see the copied bytes
+  __atomic_store_n(&header->committed, committed + size, __ATOMIC_RELEASE);
+}
+
+void MappedCSVWriter::writeRow(const vector<string> &row) {
+  thread_local string line;
+  line.clear();
+  CSVHandler::formatRow(line, row);
+  append(line.data(), line.size());
+}
+
+void MappedCSVWriter::writeFormatted(const string &rows) {
+  if (!rows.empty()) {
+    append(rows.data(), rows.size());
+  }
+}
+
+CSVTable MappedCSVWriter::readTable() const {
+  // lock-free readers race close(): both sides go through the atomic
+  // shared_ptr functions, so a reader gets the window or nothing
+  shared_ptr<Window> current = atomic_load(&window);
+  if (!current) {
+    throw runtime_error("Mapped CSV file " + filePath + " is closed.");
+  }
+  size_t committed = getCommittedLength();
+  return CSVTable(current, string_view(current->data, committed));
+}
+
+size_t MappedCSVWriter::getCommittedLength() const {
+  return __atomic_load_n(&header->committed, __ATOMIC_ACQUIRE);
+}
+
+size_t MappedCSVWriter::getReservedLength() const {
+  return __atomic_load_n(&header->reserved, __ATOMIC_ACQUIRE);
+}
+
+long MappedCSVWriter::getExtentCount() const { return extentCount.load(); }
+
+void MappedCSVWriter::sync() {
+  lock_guard<mutex> lock(appendMutex);
+  if (closed) {
+    return;
+  }
+  size_t committed = getCommittedLength();
+  if (committed > 0 && msync(window->data, committed, MS_SYNC) != 0) {
+    throw runtime_error(errnoMessage("msync failed for", filePath));
+  }
+  // the length goes to disk only after the rows it covers
+  if (msync(header, kHeaderSize, MS_SYNC) != 0) {
+    throw runtime_error(errnoMessage("msync failed for", headerPath));
+  }
+}
+
+void MappedCSVWriter::close() {
+  lock_guard<mutex> lock(appendMutex);
+  if (closed) {
+    return;
+  }
+  closed = true;
+  size_t committed = getCommittedLength();
+  // tables handed out keep the window mapped; the truncation below only
+  // drops bytes past the committed length, which no table covers
+  atomic_store(&window, shared_ptr<Window>());
+  int truncated = ftruncate(fd, committed);
+  int truncateErrno = errno;
+  ::close(fd);
+  // the header stays mapped until destruction so the getters keep working
+  ::close(headerFd);
+  if (truncated != 0) {
+    // keep the header so recover() can finish the job
+    errno = truncateErrno;
+    throw runtime_error(errnoMessage("Cannot truncate", filePath));
+  }
+  unlink(headerPath.c_str());
+}
+
+size_t MappedCSVWriter::recover(const string &path) {
+  string headerPath = path + ".commit";
+  int headerFd = open(headerPath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (headerFd < 0) {
+    throw runtime_error(errnoMessage("Cannot open", headerPath));
+  }
+  CommitHeader saved;
+  ssize_t got = pread(headerFd, &saved, sizeof(saved), 0);
+  ::close(headerFd);
+  if (got != static_cast<ssize_t>(sizeof(saved)) ||
+      saved.magic != kCommitMagic) {
+    throw runtime_error("Invalid commit header: " + headerPath);
+  }
+  if (truncate(path.c_str(), saved.committed) != 0) {
+    throw runtime_error(errnoMessage("Cannot truncate", path));
+  }
+  unlink(headerPath.c_str());
+  return saved.committed;
+}
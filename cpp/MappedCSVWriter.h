@@ -0,0 +1,78 @@
+#ifndef MAPPEDCSVWRITER_H
+#define MAPPEDCSVWRITER_H
+
+#include "util/CSVTable.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Append-only CSV writer over a memory-mapped, pre-allocated file. Space is
+// reserved with fallocate in extentSize steps, rows are memcpy'd into the
+// mapping and the committed length is published in a small mapped header
+// file (<path>.commit) with a release store. Readers in the process see
+// every committed row through readTable() without a syscall; other
+// processes can map both files the same way. The data file stays a plain
+// CSV: close() truncates it to the committed length and removes the
+// header, recover() does the same after a crash.
+class MappedCSVWriter {
+public:
+  static const size_t kDefaultExtentSize = 64 << 20;
+  static const size_t kDefaultMaxFileSize = 16UL << 30; // mapped window
+
+  // creates (or truncates) path; the window is mapped once, so rows and
+  // tables never move, and the file cannot outgrow maxFileSize
+  explicit MappedCSVWriter(const std::string &path,
+                           size_t extentSize = kDefaultExtentSize,
+                           size_t maxFileSize = kDefaultMaxFileSize);
+  ~MappedCSVWriter(); // close(), errors are logged
+
+  MappedCSVWriter(const MappedCSVWriter &) = delete;
+  MappedCSVWriter &operator=(const MappedCSVWriter &) = delete;
+
+  void writeRow(const std::vector<std::string> &row);
+  // append rows already formatted by CSVHandler::formatRow
+  void writeFormatted(const std::string &rows);
+
+  // every committed row, zero-copy views into the mapping (valid after
+  // close() too, the table keeps the mapping alive)
+  CSVTable readTable() const;
+  size_t getCommittedLength() const; // acquire load of the header
+  size_t getReservedLength() const;
+  long getExtentCount() const; // fallocate calls so far
+
+  // msync the committed rows and the header
+  void sync();
+  // sync, truncate the file to the committed length, drop the header
+  void close();
+
+  // after a crash: truncate path to the length its header committed and
+  // remove the header; returns that length
+  static size_t recover(const std::string &path);
+
+private:
+  struct Window; // the mapping, shared with the tables handed out
+  struct CommitHeader;
+
+  std::string filePath;
+  std::string headerPath;
+  size_t extentSize;
+  size_t maxFileSize;
+  int fd = -1;
+  int headerFd = -1;
+  std::shared_ptr<Window> window; // std::atomic_load/store outside appendMutex
+  CommitHeader *header = nullptr;
+
+  std::mutex appendMutex; // one writer copies and publishes at a time
+  size_t reserved = 0;    // bytes allocated in the file
+  std::atomic<long> extentCount{0};
+  bool closed = false;
+
+  void reserve(size_t length); // caller holds appendMutex
+  void append(const char *data, size_t size);
+};
+
+#endif // MAPPEDCSVWRITER_H
@@ -9,13 +9,20 @@ using namespace std;
 
 ProducerConsumerConcurrentIO::ProducerConsumerConcurrentIO(
     const string &filePath, std::shared_ptr<TaskQueue> queue, LockType lockType)
-    : csvHandler(make_unique<CSVHandler>(filePath, lockType)), taskQueue(queue),
+    : outputPath(filePath),
+      csvHandler(make_unique<CSVHandler>(filePath, lockType)),
+      csvWriter(make_unique<AsyncCSVWriter>(*csvHandler)), taskQueue(queue),
       stopProducer(false), stopConsumer(false), stopReader(false),
       tasksCompleted(0), readCompleted(false) {}
 
 // get the CSV content, for testing purposes, read all rows
 vector<vector<string>> ProducerConsumerConcurrentIO::getCSVContent() {
   try {
+    if (shardedWriter && shardedWriter->getShardCount() > 0) {
+      shardedWriter->flush(); // not compacted yet
+      return shardedWriter->readAll(MergeOrder::ById);
+    }
+    csvWriter->flush(); // rows still staged by the consumers
     return csvHandler->readAll();
   } catch (const exception &e) {
     cerr << "Error reading CSV content: " << e.what() << endl;
@@ -30,9 +37,15 @@ void ProducerConsumerConcurrentIO::executeTask(const Task &task) {
   try {
     cout << "[executeTask] Attempting to write Task ID: " << task.id << endl;
 
-    // write a row to the CSV file as one execution is done
-    csvHandler->writeRow({to_string(task.id), task.name,
-                          task.isCompleted ? "Complete" : "Incomplete"});
+    // typed rows: formatted straight into reused buffers, no vector<string>
+    if (consumerOutput == ConsumerOutput::Sharded) {
+      // this consumer's own file, no lock
+      shardedWriter->writeRow(task.id, task.name, task.isCompleted);
+    } else if (!csvWriter->writeRow(task.id, task.name, task.isCompleted)) {
+      // DropNewest and the staging buffer was full: the row is lost
+      tasksDropped.fetch_add(1);
+      cerr << "[executeTask] Row of Task ID " << task.id << " dropped" << endl;
+    }
     cout << "Executed Task ID: " << task.id << ::endl;
   } catch (const ::exception &e) {
     cerr << " Error writing to CSV: " << e.what() << ::endl;
@@ -102,7 +115,7 @@ void ProducerConsumerConcurrentIO::startProducerThread(int numTasks) {
 
   try {
     threadManager.createThread(&ProducerConsumerConcurrentIO::producerThread,
-                               data, &threadHandle);
+                               data, &threadHandle, "Producer");
   } catch (const exception &e) {
     cerr << "Error starting producer thread: " << e.what() << endl;
     delete data; // delete the data
@@ -161,7 +174,7 @@ void *ProducerConsumerConcurrentIO::consumerThread(void *arg) {
 void ProducerConsumerConcurrentIO::startConsumerThread() {
   stopConsumer = false;
   threadManager.createThread(&ProducerConsumerConcurrentIO::consumerThread,
-                             this, nullptr);
+                             this, nullptr, "Consumer");
 }
 
 // stop the consumer thread
@@ -181,21 +194,37 @@ void ProducerConsumerConcurrentIO::stopConsumerThread(int consumerTaskCount) {
 void *ProducerConsumerConcurrentIO::readerThread(void *arg) {
   ProducerConsumerConcurrentIO *manager =
       static_cast<ProducerConsumerConcurrentIO *>(arg);
+  long nextRow = 0; // first row this reader has not printed yet
+  CSVCursor cursor; // where the last readSince stopped in the CSV file
 
   while (!manager->stopReader) {
     try {
       this_thread::sleep_for(chrono::milliseconds(100)); // Adjust timing
-      auto rows = manager->csvHandler->readAll();
-      cout << "Reader Thread CSV Content:" << endl;
-      for (const auto &row : rows) {
-        for (const auto &cell : row) {
-          cout << cell << " ";
+      if (manager->consumerOutput == ConsumerOutput::Sharded) {
+        // shards have no global row order until compaction, only count
+        long rowCount = manager->shardedWriter->rowCount();
+        if (rowCount > nextRow) {
+          cout << "Reader Thread: " << rowCount << " rows in shards" << endl;
+          nextRow = rowCount;
+        }
+      } else {
+        // only the rows appended since the last poll are read and parsed
+        vector<vector<string>> rows = manager->csvHandler->readSince(cursor);
+        if (!rows.empty()) {
+          cout << "Reader Thread CSV Content (new rows):" << endl;
+          for (const vector<string> &row : rows) {
+            for (const string &cell : row) {
+              cout << cell << " ";
+            }
+            cout << endl;
+          }
         }
-        cout << endl;
+        nextRow = cursor.rowsRead;
       }
 
-      // check if all tasks are read, then stop the reader
-      if (rows.size() >= static_cast<std::size_t>(manager->tasksCompleted)) {
+      // check if all tasks are read, then stop the reader; dropped rows
+      // never reach the file
+      if (nextRow >= manager->tasksCompleted - manager->tasksDropped) {
         cout << "  Reader   All tasks read from CSV" << endl;
         manager->readCompleted.store(true);
         break;
@@ -215,7 +244,7 @@ void *ProducerConsumerConcurrentIO::readerThread(void *arg) {
 void ProducerConsumerConcurrentIO::startReaderThread() {
   stopReader = false;
   threadManager.createThread(&ProducerConsumerConcurrentIO::readerThread, this,
-                             nullptr);
+                             nullptr, "Reader");
 }
 
 // stop the reader thread
@@ -266,6 +295,10 @@ void ProducerConsumerConcurrentIO::customTasks(int producerThreads,
   
   stopConsumerThread(consumerThreads);
 
+  if (shardedWriter) {
+    shardedWriter->flush(); // make the buffered shard rows visible to readers
+  }
+
   while (!readCompleted.load()) {
     this_thread::sleep_for(chrono::milliseconds(200));
   }
@@ -275,14 +308,32 @@ void ProducerConsumerConcurrentIO::customTasks(int producerThreads,
   cout << "[test] Joining all threads..." << endl;
   threadManager.joinAllThreads();
 
+  // merge the consumers' shards into the CSV file by task id
+  if (consumerOutput == ConsumerOutput::Sharded) {
+    try {
+      long merged = shardedWriter->compact(*csvHandler);
+      shardedWriter->removeShards();
+      cout << "Compacted " << merged << " rows from shards into CSV" << endl;
+    } catch (const ::exception &e) {
+      cerr << " Error compacting shards: " << e.what() << endl;
+    }
+  }
+
   // try to read all tasks from the CSV file
   try {
-    auto rows = csvHandler->readAll();
-    if (rows.size() >= static_cast<size_t>(writeCount)) {
+    csvWriter->flush();
+    // only counted, streamed so memory does not grow with the file
+    long rowCount = csvHandler->forEachRow([](const CSVRow &) { return true; });
+    if (tasksDropped > 0) {
+      cerr << tasksDropped << " task rows were dropped by the full staging "
+           << "buffer." << endl;
+    }
+    if (rowCount >= writeCount - tasksDropped) {
       cout << " All tasks written successfully to CSV!" << endl;
     } else {
-      cerr << "Missing tasks in CSV. Expected at least " << writeCount
-           << ", found " << rows.size() << "." << endl;
+      cerr << "Missing tasks in CSV. Expected at least "
+           << writeCount - tasksDropped << ", found " << rowCount << "."
+           << endl;
     }
   } catch (const ::exception &e) {
     cerr << " Error verifying CSV content: " << e.what() << endl;
@@ -298,6 +349,10 @@ int ProducerConsumerConcurrentIO::getTasksCompleted() const {
   return tasksCompleted.load();
 }
 
+int ProducerConsumerConcurrentIO::getTasksDropped() const {
+  return tasksDropped.load();
+}
+
 bool ProducerConsumerConcurrentIO::isReadCompleted() const {
   return readCompleted.load();
 }
@@ -335,6 +390,21 @@ ThreadManager &ProducerConsumerConcurrentIO::getThreadManager() {
   return threadManager;
 }
 
+void ProducerConsumerConcurrentIO::setConsumerOutput(ConsumerOutput output) {
+  consumerOutput = output;
+  if (output == ConsumerOutput::Sharded && !shardedWriter) {
+    shardedWriter = make_unique<ShardedCSVWriter>(outputPath);
+  }
+}
+
+ConsumerOutput ProducerConsumerConcurrentIO::getConsumerOutput() const {
+  return consumerOutput;
+}
+
+AsyncCSVWriter &ProducerConsumerConcurrentIO::getCSVWriter() {
+  return *csvWriter;
+}
+
 void ProducerConsumerConcurrentIO::resetGlobalTaskCounter() {
   globalTaskCounter.store(1);
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 #ifndef PRODUCER_CONSUMER_CONCURRENT_IO_H
 #define PRODUCER_CONSUMER_CONCURRENT_IO_H
 
+#include "AsyncCSVWriter.h"
 #include "CSVHandler.h"
+#include "ShardedCSVWriter.h"
 #include "TaskQueue.h" // Include this to use Task struct
 #include "util/LockType.h"
 #include "util/MutexLock.h"
@@ -15,6 +17,12 @@
 #include <string>
 #include <vector>
 
+// Where consumers write their rows
+enum class ConsumerOutput {
+  Async,  // one CSV file, rows staged through an AsyncCSVWriter (default)
+  Sharded // one shard file per consumer, compacted into the CSV at the end
+};
+
 struct ThreadData {
   class ProducerConsumerConcurrentIO *manager;
   int taskCount;
@@ -30,11 +38,16 @@ public:
   void customTasks(int producerThreads, int produceCount, int readerThreads,
                    int consumerThreads, int writeCount);
   void executeTask(const Task &task);
+  // call before customTasks; Sharded writes <filePath>.shard<N> files and
+  // merges them into the CSV file by task id once all tasks are done
+  void setConsumerOutput(ConsumerOutput output);
+  ConsumerOutput getConsumerOutput() const;
   std::vector<std::vector<std::string>> getCSVContent();
 
   // Getters
   static int getGlobalTaskCounter();
   int getTasksCompleted() const;
+  int getTasksDropped() const; // rows the async writer discarded
   bool isReadCompleted() const;
   std::shared_ptr<TaskQueue> getTaskQueue() const;
   const std::map<pthread_t, int> &getThreadTaskCount() const;
@@ -44,6 +57,7 @@ public:
   const std::vector<pthread_t> &getReaderThreadIds() const;
   void resetGlobalTaskCounter();
   ThreadManager &getThreadManager();
+  AsyncCSVWriter &getCSVWriter();
 
 private:
   // Thread functions
@@ -63,8 +77,12 @@ private:
   std::map<pthread_t, long long> threadActiveTime;
 
   // Synchronization
+  std::string outputPath; // the CSV file, shards are named after it
   std::shared_ptr<TaskQueue> taskQueue;
   std::unique_ptr<CSVHandler> csvHandler;
+  std::unique_ptr<AsyncCSVWriter> csvWriter; // consumers stage rows here
+  ConsumerOutput consumerOutput = ConsumerOutput::Async;
+  std::unique_ptr<ShardedCSVWriter> shardedWriter; // Sharded output only
   ThreadManager threadManager;
 
   // Control flags
@@ -73,6 +91,7 @@ private:
   std::atomic<bool> stopReader;
   std::atomic<bool> readCompleted;
   std::atomic<int> tasksCompleted;
+  std::atomic<int> tasksDropped{0}; // DropNewest rows, never in the file
 
   // Thread IDs
   std::vector<pthread_t> producerThreadIds;
@@ -0,0 +1,373 @@
+#include "SegmentedCSVHandler.h"
+#include "util/TraceRecorder.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+SegmentedCSVHandler::SegmentedCSVHandler(const string &basePath,
+                                         LockType lockType, long maxRows,
+                                         long maxBytes)
+    : basePath(basePath), manifestPath(basePath + ".manifest"),
+      lockType(lockType), maxRows(maxRows), maxBytes(maxBytes) {
+  if (maxRows < 0 || maxBytes < 0) {
+    throw invalid_argument("Segment limits must not be negative.");
+  }
+  lock_guard<mutex> guard(segmentMutex);
+  openSegment(0, 0);
+  writeManifest();
+}
+
+string SegmentedCSVHandler::segmentPath(int id) const {
+  return basePath + "." + to_string(id) + ".csv";
+}
+
+// start an empty active segment
+void SegmentedCSVHandler::openSegment(int id, long firstRow) {
+  active = make_shared<CSVHandler>(segmentPath(id), lockType);
+  active->setFlushPolicy(flushPolicy, flushThreshold);
+  activeInfo = SegmentInfo();
+  activeInfo.id = id;
+  activeInfo.path = segmentPath(id);
+  activeInfo.firstRow = firstRow;
+  activeBytes = 0;
+}
+
+// seal the active segment and continue in a new one
+void SegmentedCSVHandler::rotate() {
+  TraceScope trace("SegmentedCSVHandler::rotate", "csv");
+  active->flush();
+  SegmentInfo sealed = activeInfo;
+  sealed.sealed = true;
+  sealed.byteSize = filesystem::file_size(sealed.path);
+  sealedSegments.push_back(sealed);
+  // readers still holding the old handler keep it alive until they finish
+  openSegment(sealed.id + 1, sealed.firstRow + sealed.rowCount);
+  rotationCount++;
+  writeManifest();
+}
+
+// write to a temporary file and rename it over the manifest, so readers
+// never see a half-written one
+void SegmentedCSVHandler::writeManifest() const {
+  string contents = "segment,path,firstRow,rowCount,bytes,state\n";
+  auto append = [&contents](const SegmentInfo &segment) {
+    CSVHandler::formatRow(
+        contents, {to_string(segment.id), segment.path,
+                   to_string(segment.firstRow), to_string(segment.rowCount),
+                   to_string(segment.byteSize),
+                   segment.sealed ? "sealed" : "active"});
+  };
+  for (const SegmentInfo &segment : sealedSegments) {
+    append(segment);
+  }
+  append(activeInfo);
+
+  string temporaryPath = manifestPath + ".tmp";
+  {
+    ofstream file(temporaryPath, ios::trunc);
+    if (!file.is_open()) {
+      throw runtime_error("Cannot write manifest: " + temporaryPath);
+    }
+    file << contents;
+    if (!file) {
+      throw runtime_error("Cannot write manifest: " + temporaryPath);
+    }
+  }
+  filesystem::rename(temporaryPath, manifestPath);
+}
+
+// wait until no rotation runs, then keep new writers out and wait for the
+// ones still writing to the active segment
+void SegmentedCSVHandler::beginExclusive(unique_lock<mutex> &guard) {
+  writersDone.wait(guard, [this] { return !rotating; });
+  rotating = true;
+  writersDone.wait(guard, [this] { return writersInFlight == 0; });
+}
+
+void SegmentedCSVHandler::endExclusive() {
+  rotating = false;
+  writersDone.notify_all();
+}
+
+void SegmentedCSVHandler::writeRow(const vector<string> &row) {
+  long bytes = row.empty() ? 1 : row.size(); // separators and newline
+  for (const string &cell : row) {
+    bytes += cell.size();
+  }
+
+  // count the row against the active segment under the lock, write it
+  // without; the row that fills the segment rotates it
+  unique_lock<mutex> guard(segmentMutex);
+  writersDone.wait(guard, [this] { return !rotating; });
+  shared_ptr<CSVHandler> target = active;
+  activeInfo.rowCount++;
+  activeBytes += bytes;
+  bool fills = (maxRows > 0 && activeInfo.rowCount >= maxRows) ||
+               (maxBytes > 0 && activeBytes >= maxBytes);
+  if (fills) {
+    rotating = true; // later rows wait for the next segment
+  }
+  writersInFlight++;
+  guard.unlock();
+
+  try {
+    target->writeRow(row);
+  } catch (...) {
+    guard.lock();
+    activeInfo.rowCount--; // still the same segment, it waits for us
+    activeBytes -= bytes;
+    writersInFlight--;
+    if (fills) {
+      rotating = false;
+    }
+    writersDone.notify_all();
+    throw;
+  }
+
+  guard.lock();
+  writersInFlight--;
+  if (!fills) {
+    if (writersInFlight == 0) {
+      writersDone.notify_all();
+    }
+    return;
+  }
+  writersDone.wait(guard, [this] { return writersInFlight == 0; });
+  try {
+    rotate();
+  } catch (...) {
+    endExclusive();
+    throw;
+  }
+  endExclusive();
+}
+
+void SegmentedCSVHandler::flush() {
+  lock_guard<mutex> guard(segmentMutex);
+  active->flush();
+}
+
+void SegmentedCSVHandler::setFlushPolicy(FlushPolicy policy, long threshold) {
+  lock_guard<mutex> guard(segmentMutex);
+  active->setFlushPolicy(policy, threshold);
+  flushPolicy = policy;
+  flushThreshold = threshold;
+}
+
+void SegmentedCSVHandler::rotateNow() {
+  unique_lock<mutex> guard(segmentMutex);
+  beginExclusive(guard);
+  try {
+    if (activeInfo.rowCount > 0) {
+      rotate();
+    }
+  } catch (...) {
+    endExclusive();
+    throw;
+  }
+  endExclusive();
+}
+
+long SegmentedCSVHandler::rowCount() const {
+  lock_guard<mutex> guard(segmentMutex);
+  return activeInfo.firstRow + active->rowCount();
+}
+
+long SegmentedCSVHandler::firstAvailableRow() const {
+  lock_guard<mutex> guard(segmentMutex);
+  return sealedSegments.empty() ? activeInfo.firstRow
+                                : sealedSegments.front().firstRow;
+}
+
+long SegmentedCSVHandler::forEachRow(
+    long first, long last,
+    const function<bool(const CSVRow &)> &callback) const {
+  TraceScope trace("SegmentedCSVHandler::forEachRow", "csv");
+  // pick the segments under the lock, read them without it
+  vector<SegmentInfo> segments;
+  shared_ptr<CSVHandler> activeHandler;
+  long activeFirstRow;
+  long available;
+  long end;
+  {
+    lock_guard<mutex> guard(segmentMutex);
+    available = sealedSegments.empty() ? activeInfo.firstRow
+                                       : sealedSegments.front().firstRow;
+    end = activeInfo.firstRow + active->rowCount();
+    for (const SegmentInfo &segment : sealedSegments) {
+      if (segment.firstRow < last &&
+          segment.firstRow + segment.rowCount > first) {
+        segments.push_back(segment);
+      }
+    }
+    activeHandler = active;
+    activeFirstRow = activeInfo.firstRow;
+  }
+  if (first < available || last > end || first > last) {
+    throw out_of_range("Rows [" + to_string(first) + ", " + to_string(last) +
+                       ") outside of [" + to_string(available) + ", " +
+                       to_string(end) + "): " + basePath);
+  }
+
+  long visited = 0;
+  for (const SegmentInfo &segment : segments) {
+    ifstream file(segment.path, ios::binary);
+    if (!file.is_open()) {
+      throw runtime_error("Cannot open segment: " + segment.path);
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    CSVTable table(contents.str());
+    long begin = max(first, segment.firstRow) - segment.firstRow;
+    long stop = min(last, segment.firstRow + segment.rowCount) -
+                segment.firstRow;
+    for (long i = begin; i < stop; ++i) {
+      visited++;
+      if (!callback(table.row(i))) {
+        return visited;
+      }
+    }
+  }
+  if (last > activeFirstRow) {
+    long begin = max(first, activeFirstRow) - activeFirstRow;
+    CSVTable table =
+        activeHandler->readRange(begin, last - activeFirstRow);
+    for (CSVRow row : table) {
+      visited++;
+      if (!callback(row)) {
+        return visited;
+      }
+    }
+  }
+  return visited;
+}
+
+vector<vector<string>> SegmentedCSVHandler::readRows(long first,
+                                                     long last) const {
+  vector<vector<string>> rows;
+  forEachRow(first, last, [&rows](const CSVRow &row) {
+    rows.push_back(row.toVector());
+    return true;
+  });
+  return rows;
+}
+
+vector<vector<string>> SegmentedCSVHandler::readAll() const {
+  long first;
+  long last;
+  {
+    lock_guard<mutex> guard(segmentMutex);
+    first = sealedSegments.empty() ? activeInfo.firstRow
+                                   : sealedSegments.front().firstRow;
+    last = activeInfo.firstRow + active->rowCount();
+  }
+  return readRows(first, last);
+}
+
+void SegmentedCSVHandler::clear() {
+  unique_lock<mutex> guard(segmentMutex);
+  beginExclusive(guard);
+  try {
+    for (const SegmentInfo &segment : sealedSegments) {
+      filesystem::remove(segment.path);
+    }
+    sealedSegments.clear();
+    active->clear();
+    activeInfo.firstRow = 0;
+    activeInfo.rowCount = 0;
+    activeBytes = 0;
+    writeManifest();
+  } catch (...) {
+    endExclusive();
+    throw;
+  }
+  endExclusive();
+}
+
+int SegmentedCSVHandler::dropSegmentsBefore(long row) {
+  lock_guard<mutex> guard(segmentMutex);
+  int dropped = 0;
+  while (!sealedSegments.empty() &&
+         sealedSegments.front().firstRow + sealedSegments.front().rowCount <=
+             row) {
+    filesystem::remove(sealedSegments.front().path);
+    sealedSegments.erase(sealedSegments.begin());
+    dropped++;
+  }
+  if (dropped > 0) {
+    writeManifest();
+  }
+  return dropped;
+}
+
+int SegmentedCSVHandler::archiveSegmentsBefore(long row,
+                                               const string &directory) {
+  lock_guard<mutex> guard(segmentMutex);
+  filesystem::create_directories(directory);
+  int archived = 0;
+  while (!sealedSegments.empty() &&
+         sealedSegments.front().firstRow + sealedSegments.front().rowCount <=
+             row) {
+    filesystem::path source = sealedSegments.front().path;
+    filesystem::path target = filesystem::path(directory) / source.filename();
+    error_code error;
+    filesystem::rename(source, target, error);
+    if (error) {
+      // another file system, copy then delete
+      filesystem::copy_file(source, target,
+                            filesystem::copy_options::overwrite_existing);
+      filesystem::remove(source);
+    }
+    sealedSegments.erase(sealedSegments.begin());
+    archived++;
+  }
+  if (archived > 0) {
+    writeManifest();
+  }
+  return archived;
+}
+
+vector<SegmentInfo> SegmentedCSVHandler::getSegments() const {
+  lock_guard<mutex> guard(segmentMutex);
+  vector<SegmentInfo> segments = sealedSegments;
+  segments.push_back(activeInfo);
+  return segments;
+}
+
+string SegmentedCSVHandler::getManifestPath() const { return manifestPath; }
+
+long SegmentedCSVHandler::getRotationCount() const {
+  lock_guard<mutex> guard(segmentMutex);
+  return rotationCount;
+}
+
+vector<SegmentInfo> SegmentedCSVHandler::readManifest(const string &path) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open()) {
+    throw runtime_error("Cannot open manifest: " + path);
+  }
+  ostringstream contents;
+  contents << file.rdbuf();
+  CSVTable table(contents.str());
+
+  vector<SegmentInfo> segments;
+  for (size_t i = 1; i < table.rowCount(); ++i) { // row 0 is the header
+    CSVRow row = table.row(i);
+    if (row.size() != 6) {
+      throw runtime_error("Malformed manifest row in " + path);
+    }
+    SegmentInfo segment;
+    segment.id = stoi(string(row[0]));
+    segment.path = string(row[1]);
+    segment.firstRow = stol(string(row[2]));
+    segment.rowCount = stol(string(row[3]));
+    segment.byteSize = stol(string(row[4]));
+    segment.sealed = row[5] == "sealed";
+    segments.push_back(segment);
+  }
+  return segments;
+}
@@ -0,0 +1,105 @@
+#ifndef SEGMENTEDCSVHANDLER_H
+#define SEGMENTEDCSVHANDLER_H
+
+#include "CSVHandler.h"
+#include "util/CSVTable.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One segment file of a SegmentedCSVHandler, as listed in its manifest
+struct SegmentInfo {
+  int id = 0;
+  std::string path;
+  long firstRow = 0; // global number of the segment's first row
+  long rowCount = 0; // rows in the segment (so far, for the active one)
+  long byteSize = 0; // file size when sealed, 0 while active
+  bool sealed = false;
+};
+
+// CSV log split into segment files (<basePath>.<id>.csv). Rows go to the
+// active segment, a CSVHandler; once it holds maxRows rows or about
+// maxBytes bytes (unquoted row size) it is flushed, sealed and a new
+// segment starts. The manifest (<basePath>.manifest, a CSV rewritten
+// atomically on every change) lists each segment with its global row range,
+// so a reader opens only the segments its rows are in, and sealed segments
+// can be archived or deleted while the active one keeps growing. Rows keep
+// their global numbers after older segments are dropped.
+class SegmentedCSVHandler {
+private:
+  std::string basePath;
+  std::string manifestPath;
+  LockType lockType;
+  long maxRows;  // 0: no row limit
+  long maxBytes; // 0: no byte limit
+  FlushPolicy flushPolicy = FlushPolicy::PerRow;
+  long flushThreshold = 0;
+
+  // guards the segment list and the active segment. Writers hold it only to
+  // count their row, then write to the active CSVHandler without it; a
+  // rotation (or clear) sets rotating and waits for writersInFlight to
+  // drain, so a row never lands in a sealed segment.
+  mutable std::mutex segmentMutex;
+  std::condition_variable writersDone; // writersInFlight or rotating changed
+  int writersInFlight = 0; // rows counted but still being written
+  bool rotating = false;   // the active segment takes no new rows
+  std::vector<SegmentInfo> sealedSegments; // oldest first
+  std::shared_ptr<CSVHandler> active;
+  SegmentInfo activeInfo;
+  long activeBytes = 0; // estimated bytes written to the active segment
+  long rotationCount = 0;
+
+  std::string segmentPath(int id) const;
+  void openSegment(int id, long firstRow); // caller holds segmentMutex
+  void rotate();                           // caller holds segmentMutex
+  void writeManifest() const;              // caller holds segmentMutex
+  void beginExclusive(std::unique_lock<std::mutex> &guard);
+  void endExclusive(); // caller holds segmentMutex
+
+public:
+  // starts from an empty first segment, like CSVHandler truncates its file
+  SegmentedCSVHandler(const std::string &basePath,
+                      LockType lockType = LockType::Mutex,
+                      long maxRows = 100000, long maxBytes = 0);
+
+  SegmentedCSVHandler(const SegmentedCSVHandler &) = delete;
+  SegmentedCSVHandler &operator=(const SegmentedCSVHandler &) = delete;
+
+  void writeRow(const std::vector<std::string> &row);
+  void flush();
+  // applied to the active segment and to every later one
+  void setFlushPolicy(FlushPolicy policy, long threshold = 0);
+  // seal the active segment now (if it has rows)
+  void rotateNow();
+
+  // rows written and flushed, counting rows of dropped segments
+  long rowCount() const;
+  // first row still kept, rows before it were in dropped segments
+  long firstAvailableRow() const;
+  // visit rows [first, last) reading only the segments that hold them;
+  // throws out_of_range outside [firstAvailableRow(), rowCount())
+  long forEachRow(long first, long last,
+                  const std::function<bool(const CSVRow &)> &callback) const;
+  std::vector<std::vector<std::string>> readRows(long first, long last) const;
+  std::vector<std::vector<std::string>> readAll() const;
+
+  // drop every segment and start an empty one, cost independent of history
+  void clear();
+  // delete (or move into directory) the sealed segments that end at or
+  // before row; the active segment is never touched. Returns the count.
+  int dropSegmentsBefore(long row);
+  int archiveSegmentsBefore(long row, const std::string &directory);
+
+  // the segments, sealed ones first, then the active one
+  std::vector<SegmentInfo> getSegments() const;
+  std::string getManifestPath() const;
+  long getRotationCount() const;
+
+  // parse a manifest written by this class
+  static std::vector<SegmentInfo> readManifest(const std::string &path);
+};
+
+#endif // SEGMENTEDCSVHANDLER_H
@@ -0,0 +1,280 @@
+#include "ShardedCSVWriter.h"
+#include "util/TraceRecorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+atomic<uint64_t> nextWriterId{1};
+
+// id in the first cell, LONG_MIN when there is none
+long rowId(const CSVRow &row) {
+  long id = LONG_MIN;
+  if (!row.empty()) {
+    from_chars(row[0].data(), row[0].data() + row[0].size(), id);
+  }
+  return id;
+}
+} // namespace
+
+ShardedCSVWriter::ShardedCSVWriter(const string &basePath, size_t flushBytes)
+    : basePath(basePath), flushBytes(flushBytes),
+      writerId(nextWriterId.fetch_add(1)) {}
+
+ShardedCSVWriter::~ShardedCSVWriter() {
+  try {
+    flush();
+  } catch (const exception &e) {
+    cerr << "Error flushing shards on close: " << e.what() << endl;
+  }
+  for (auto &shard : shards) {
+    if (shard->fd >= 0) {
+      ::close(shard->fd);
+    }
+  }
+}
+
+// the calling thread's shard; after the first lookup it comes from a
+// thread-local cache, so the registry lock is taken once per thread
+ShardedCSVWriter::Shard &ShardedCSVWriter::shardForThisThread() {
+  thread_local uint64_t cachedWriterId = 0;
+  thread_local Shard *cachedShard = nullptr;
+  if (cachedWriterId == writerId) {
+    return *cachedShard;
+  }
+
+  lock_guard<mutex> guard(registryMutex);
+  Shard *&shard = threadShards[this_thread::get_id()];
+  if (shard == nullptr) {
+    auto created = make_unique<Shard>();
+    created->path = basePath + ".shard" + to_string(shards.size());
+    created->fd = open(created->path.c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                       0644);
+    if (created->fd < 0) {
+      threadShards.erase(this_thread::get_id());
+      throw runtime_error("Cannot open shard for writing: " + created->path);
+    }
+    shard = created.get();
+    shards.push_back(move(created));
+  }
+  cachedWriterId = writerId;
+  cachedShard = shard;
+  return *shard;
+}
+
+void ShardedCSVWriter::flushShard(Shard &shard) {
+  size_t written = 0;
+  while (written < shard.buffer.size()) {
+    ssize_t result = ::write(shard.fd, shard.buffer.data() + written,
+                             shard.buffer.size() - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("Shard write failed: " + shard.path + ": " +
+                          strerror(errno));
+    }
+    written += result;
+  }
+  shard.rowsWritten += shard.bufferedRows;
+  shard.bufferedRows = 0;
+  shard.buffer.clear();
+}
+
+void ShardedCSVWriter::writeRow(const vector<string> &row) {
+  Shard &shard = shardForThisThread();
+  lock_guard<mutex> guard(shard.shardMutex); // uncontended but for flush()
+  CSVHandler::formatRow(shard.buffer, row);
+  rowAdded(shard);
+}
+
+void ShardedCSVWriter::writeRow(int id, string_view name, bool done) {
+  Shard &shard = shardForThisThread();
+  lock_guard<mutex> guard(shard.shardMutex);
+  CSVHandler::formatRow(shard.buffer, id, name, done);
+  rowAdded(shard);
+}
+
+// count the formatted row, write the buffer out once it is large enough
+void ShardedCSVWriter::rowAdded(Shard &shard) {
+  shard.bufferedRows++;
+  shard.rowsAdded.fetch_add(1, memory_order_relaxed);
+  if (shard.buffer.size() >= flushBytes) {
+    TraceScope trace("ShardedCSVWriter::flushShard", "csv");
+    flushShard(shard);
+  }
+}
+
+void ShardedCSVWriter::flush() {
+  lock_guard<mutex> guard(registryMutex);
+  for (auto &shard : shards) {
+    lock_guard<mutex> shardGuard(shard->shardMutex);
+    flushShard(*shard);
+  }
+}
+
+long ShardedCSVWriter::rowCount() const {
+  lock_guard<mutex> guard(registryMutex);
+  long rows = 0;
+  for (const auto &shard : shards) {
+    rows += shard->rowsAdded.load(memory_order_relaxed);
+  }
+  return rows;
+}
+
+long ShardedCSVWriter::writtenRowCount() const {
+  lock_guard<mutex> guard(registryMutex);
+  long rows = 0;
+  for (const auto &shard : shards) {
+    rows += shard->rowsWritten.load();
+  }
+  return rows;
+}
+
+int ShardedCSVWriter::getShardCount() const {
+  lock_guard<mutex> guard(registryMutex);
+  return shards.size();
+}
+
+vector<string> ShardedCSVWriter::getShardPaths() const {
+  lock_guard<mutex> guard(registryMutex);
+  vector<string> paths;
+  for (const auto &shard : shards) {
+    paths.push_back(shard->path);
+  }
+  return paths;
+}
+
+// a write may be in flight, only complete rows are parsed
+vector<CSVTable> ShardedCSVWriter::readShards() const {
+  vector<CSVTable> tables;
+  for (const string &path : getShardPaths()) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+      throw runtime_error("Cannot open shard: " + path);
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    tables.emplace_back(contents.str(), true);
+  }
+  return tables;
+}
+
+long ShardedCSVWriter::forEachRow(
+    MergeOrder order, const function<bool(const CSVRow &)> &callback) const {
+  TraceScope trace("ShardedCSVWriter::forEachRow", "csv");
+  vector<CSVTable> tables = readShards();
+  long visited = 0;
+
+  if (order == MergeOrder::Concatenate) {
+    for (const CSVTable &table : tables) {
+      for (CSVRow row : table) {
+        visited++;
+        if (!callback(row)) {
+          return visited;
+        }
+      }
+    }
+    return visited;
+  }
+
+  // per shard: row ids and the rows in id order (write order if sorted)
+  vector<vector<long>> ids(tables.size());
+  vector<vector<size_t>> orders(tables.size());
+  for (size_t s = 0; s < tables.size(); ++s) {
+    for (CSVRow row : tables[s]) {
+      ids[s].push_back(rowId(row));
+    }
+    orders[s].resize(ids[s].size());
+    for (size_t i = 0; i < orders[s].size(); ++i) {
+      orders[s][i] = i;
+    }
+    if (!is_sorted(ids[s].begin(), ids[s].end())) {
+      const vector<long> &shardIds = ids[s];
+      stable_sort(orders[s].begin(), orders[s].end(),
+                  [&shardIds](size_t a, size_t b) {
+                    return shardIds[a] < shardIds[b];
+                  });
+    }
+  }
+
+  // k-way merge: the heap holds the next (id, shard) of every shard
+  using Head = pair<long, size_t>;
+  priority_queue<Head, vector<Head>, greater<Head>> heads;
+  vector<size_t> positions(tables.size(), 0);
+  for (size_t s = 0; s < tables.size(); ++s) {
+    if (!orders[s].empty()) {
+      heads.push({ids[s][orders[s][0]], s});
+    }
+  }
+  while (!heads.empty()) {
+    size_t s = heads.top().second;
+    heads.pop();
+    size_t rowIndex = orders[s][positions[s]++];
+    visited++;
+    if (!callback(tables[s].row(rowIndex))) {
+      return visited;
+    }
+    if (positions[s] < orders[s].size()) {
+      heads.push({ids[s][orders[s][positions[s]]], s});
+    }
+  }
+  return visited;
+}
+
+vector<vector<string>> ShardedCSVWriter::readAll(MergeOrder order) const {
+  vector<vector<string>> rows;
+  forEachRow(order, [&rows](const CSVRow &row) {
+    rows.push_back(row.toVector());
+    return true;
+  });
+  return rows;
+}
+
+// merged rows go to target in batches of about 1 MB
+long ShardedCSVWriter::compact(CSVHandler &target, MergeOrder order) {
+  TraceScope trace("ShardedCSVWriter::compact", "csv");
+  const size_t kBatchBytes = 1 << 20;
+  flush();
+  string batch;
+  int batchRows = 0;
+  long rows = forEachRow(order, [&](const CSVRow &row) {
+    CSVHandler::formatRow(batch, row);
+    batchRows++;
+    if (batch.size() >= kBatchBytes) {
+      target.writeFormatted(batch, batchRows);
+      batch.clear();
+      batchRows = 0;
+    }
+    return true;
+  });
+  if (batchRows > 0) {
+    target.writeFormatted(batch, batchRows);
+  }
+  return rows;
+}
+
+void ShardedCSVWriter::removeShards() {
+  lock_guard<mutex> guard(registryMutex);
+  for (auto &shard : shards) {
+    if (shard->fd >= 0) {
+      ::close(shard->fd);
+    }
+    ::unlink(shard->path.c_str());
+  }
+  shards.clear();
+  threadShards.clear();
+  writerId = nextWriterId.fetch_add(1); // drop the thread-local caches
+}
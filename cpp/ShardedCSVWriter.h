@@ -0,0 +1,92 @@
+#ifndef SHARDEDCSVWRITER_H
+#define SHARDEDCSVWRITER_H
+
+#include "CSVHandler.h"
+#include "util/CSVTable.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Order of the rows in a merged view of the shards
+enum class MergeOrder {
+  Concatenate, // shard by shard, each in write order
+  ById         // k-way merge on the integer id in the first cell
+};
+
+// Sink where every writer thread appends to its own shard file
+// (basePath.shard<N>), so writers never wait on each other. Each shard
+// buffers formatted rows and writes them with one write(2) per flushBytes;
+// its mutex is only ever contended by flush(). Readers see the complete rows
+// already written to the shard files, merged in the requested order, and
+// compact() writes that merged view into one canonical CSV.
+class ShardedCSVWriter {
+private:
+  struct Shard {
+    std::mutex shardMutex; // owner thread vs flush()
+    std::string path;
+    int fd = -1;
+    std::string buffer; // formatted rows not written yet
+    std::atomic<long> rowsAdded{0};   // buffered ones included
+    std::atomic<long> rowsWritten{0}; // in the shard file
+    long bufferedRows = 0;
+  };
+
+  std::string basePath;
+  size_t flushBytes;
+  std::atomic<uint64_t> writerId; // tells thread-local cache entries apart
+
+  mutable std::mutex registryMutex; // guards shards and threadShards
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::map<std::thread::id, Shard *> threadShards;
+
+  Shard &shardForThisThread();
+  void flushShard(Shard &shard); // caller holds shard.shardMutex
+  void rowAdded(Shard &shard);   // caller holds shard.shardMutex
+  // parsed complete rows of every shard, in shard order
+  std::vector<CSVTable> readShards() const;
+
+public:
+  static const size_t kDefaultFlushBytes = 1 << 16;
+
+  explicit ShardedCSVWriter(const std::string &basePath,
+                            size_t flushBytes = kDefaultFlushBytes);
+  ~ShardedCSVWriter(); // flushes; the shard files are kept
+
+  ShardedCSVWriter(const ShardedCSVWriter &) = delete;
+  ShardedCSVWriter &operator=(const ShardedCSVWriter &) = delete;
+
+  // append to the calling thread's shard, created on its first row
+  void writeRow(const std::vector<std::string> &row);
+  // Typed task row, see CSVHandler::writeRow(int, string_view, bool)
+  void writeRow(int id, std::string_view name, bool done);
+  // write every shard's buffered rows
+  void flush();
+
+  // rows written so far, including those still buffered in a shard
+  long rowCount() const;
+  // rows already in the shard files, what forEachRow can see
+  long writtenRowCount() const;
+  int getShardCount() const;
+  std::vector<std::string> getShardPaths() const;
+
+  // visit the merged rows; the callback returns false to stop early.
+  // ById expects numeric ids (others sort first) and sorts a shard whose
+  // rows are out of order before merging. Returns the rows visited.
+  long forEachRow(MergeOrder order,
+                  const std::function<bool(const CSVRow &)> &callback) const;
+  std::vector<std::vector<std::string>> readAll(MergeOrder order) const;
+
+  // flush and append the merged rows to target, returns the rows written
+  long compact(CSVHandler &target, MergeOrder order = MergeOrder::ById);
+  // delete the shard files, call once writers are done
+  void removeShards();
+};
+
+#endif // SHARDEDCSVWRITER_H
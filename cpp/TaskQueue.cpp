@@ -1,10 +1,15 @@
 #include "TaskQueue.h"
+#include "util/CycleClock.h"
+#include "util/TraceRecorder.h"
 #include <stdexcept>
 using namespace std;
 
 // Constructor, initialize the lock type and lock pointer
-TaskQueue::TaskQueue(LockType type, void *lock)
-    : lockType(type), mutexLock(nullptr), rwLock(nullptr),
+TaskQueue::TaskQueue(LockType type, void *lock,
+                     pmr::memory_resource *resource)
+    : resource(resource), tasksQueue(pmr::deque<Task>(resource)),
+      lockType(type),
+      mutexLock(nullptr), rwLock(nullptr),
       isExternalLock(lock != nullptr) {
   if (type == LockType::Mutex && lock != nullptr) {
     mutexLock = static_cast<MutexLock *>(lock);
@@ -50,9 +55,10 @@ TaskQueue::~TaskQueue() {
   pthread_mutex_destroy(&queueMutex);
 }
 
-void TaskQueue::lock() {
+void TaskQueue::lock(const char *site) {
   if (lockType == LockType::Mutex) {
-    mutexLock->mutexLockOn();
+    mutexLock->mutexLockFrom(
+        __builtin_extract_return_addr(__builtin_return_address(0)), site);
   } else if (lockType == LockType::RWLock) {
     rwLock->writeLock();
   } else {
@@ -72,22 +78,27 @@ void TaskQueue::unlock() {
 }
 
 // enqueue tasks
-void TaskQueue::enqueue(const Task &t) {
-  auto start = chrono::high_resolution_clock::now();
+// copied straight into the queue's resource
+void TaskQueue::enqueue(const Task &t) { enqueue(Task(t, resource)); }
+
+void TaskQueue::enqueue(Task &&t) {
+  TraceScope trace("TaskQueue::enqueue", "queue");
+  uint64_t start = CycleClock::now();
 
   pthread_mutex_lock(&queueMutex); // lock the condition mutex
-  lock();
-  tasksQueue.push(t); // add the task to the queue
+  lock("TaskQueue::enqueue");
+  tasksQueue.push(move(t)); // add the task to the queue
   int currentLength = tasksQueue.size();
   maxQueueLength = std::max(maxQueueLength.load(), currentLength);
+  if (TraceRecorder::isEnabled()) {
+    TraceRecorder::counter("queueLength", currentLength);
+  }
   unlock();                          // unlock the queue
   pthread_mutex_unlock(&queueMutex); // unlock the queue]
   pthread_cond_signal(&cond);        // Notify a waiting thread
 
-  // Benchmark Tools, time calculation
-  auto end = chrono::high_resolution_clock::now();
-  long timeTaken =
-      chrono::duration_cast<chrono::microseconds>(end - start).count();
+  // Benchmark Tools, time calculation in ticks
+  long timeTaken = CycleClock::now() - start;
   totalEnqueueTime += timeTaken;
   enqueueCount++;
   maxEnqueueTime = max(maxEnqueueTime.load(), timeTaken);
@@ -96,20 +107,24 @@ void TaskQueue::enqueue(const Task &t) {
 
 // dequeue tasks
 bool TaskQueue::dequeue(Task &t) {
+  TraceScope trace("TaskQueue::dequeue", "queue");
 
   pthread_mutex_lock(&queueMutex); // Lock condition mutex
 
+  if (tasksQueue.empty() && TraceRecorder::isEnabled()) {
+    TraceRecorder::instant("TaskQueue empty", "queue");
+  }
   while (tasksQueue.empty()) { // Wait until there is a task
     pthread_cond_wait(&cond, &queueMutex);
   }
 
   pthread_mutex_unlock(&queueMutex); // Unlock condition mutex
-  lock();                            // lock the queue
+  lock("TaskQueue::dequeue");        // lock the queue
 
   if (!tasksQueue.empty()) {
-    auto start = chrono::high_resolution_clock::now();
+    uint64_t start = CycleClock::now();
 
-    Task frontTask = tasksQueue.front();
+    Task &frontTask = tasksQueue.front();
 
     // terminate the dequeue operation if termination signal is received
     if (frontTask.id == -1) { // Check for termination signal
@@ -119,8 +134,11 @@ bool TaskQueue::dequeue(Task &t) {
       return false; // Indicate that termination signal was received
     }
 
-    t = frontTask;    // get the task from the front
+    t = move(frontTask); // get the task from the front
     tasksQueue.pop(); // remove the task from the queue
+    if (TraceRecorder::isEnabled()) {
+      TraceRecorder::counter("queueLength", tasksQueue.size());
+    }
     // print for debugging
     // ---------------------------------------------
     cout << "Task " << t.id << " is removed from the queue" << endl;
@@ -128,10 +146,8 @@ bool TaskQueue::dequeue(Task &t) {
 
     unlock(); // unlock the queue
 
-    // Benchmark Tools, time calculation, end time
-    auto end = chrono::high_resolution_clock::now();
-    long timeTaken =
-        chrono::duration_cast<chrono::microseconds>(end - start).count();
+    // Benchmark Tools, time calculation in ticks, end time
+    long timeTaken = CycleClock::now() - start;
     totalDequeueTime += timeTaken;
     dequeueCount++;
     maxDequeueTime = max(maxDequeueTime.load(), timeTaken);
@@ -146,7 +162,7 @@ bool TaskQueue::dequeue(Task &t) {
 
 // dequeue all tasks
 void TaskQueue::dequeueAll() {
-  lock(); // lock the queue
+  lock("TaskQueue::dequeueAll"); // lock the queue
   while (!tasksQueue.empty()) {
     Task t = tasksQueue.front();
     tasksQueue.pop(); // remove the task from the queue
@@ -157,7 +173,7 @@ void TaskQueue::dequeueAll() {
 
 // check if the queue is empty
 bool TaskQueue::isEmpty() {
-  lock(); // lock the queue
+  lock("TaskQueue::isEmpty"); // lock the queue
   bool empty = tasksQueue.empty();
   unlock(); // unlock the queue
   return empty;
@@ -165,27 +181,47 @@ bool TaskQueue::isEmpty() {
 
 // get the size of the queue
 int TaskQueue::queueSize() {
-  lock(); // lock the queue
+  lock("TaskQueue::queueSize"); // lock the queue
   int size = tasksQueue.size();
   unlock(); // unlock the queue
   return size;
 }
 
-// Benchmark metrics
-long TaskQueue::getTotalEnqueueTime() const { return totalEnqueueTime; }
-long TaskQueue::getTotalDequeueTime() const { return totalDequeueTime; }
+// Benchmark metrics, ticks are converted to us only here
+namespace {
+long ticksToMicroseconds(long ticks) {
+  return ticks == LONG_MAX ? LONG_MAX : CycleClock::toMicroseconds(ticks);
+}
+} // namespace
+
+long TaskQueue::getTotalEnqueueTime() const {
+  return ticksToMicroseconds(totalEnqueueTime);
+}
+long TaskQueue::getTotalDequeueTime() const {
+  return ticksToMicroseconds(totalDequeueTime);
+}
 double TaskQueue::getAverageEnqueueTime() const {
-  return enqueueCount > 0 ? static_cast<double>(totalEnqueueTime) / enqueueCount
+  return enqueueCount > 0 ? CycleClock::toNanoseconds(totalEnqueueTime) /
+                                1000.0 / enqueueCount
                           : 0;
 }
 double TaskQueue::getAverageDequeueTime() const {
-  return dequeueCount > 0 ? static_cast<double>(totalDequeueTime) / dequeueCount
+  return dequeueCount > 0 ? CycleClock::toNanoseconds(totalDequeueTime) /
+                                1000.0 / dequeueCount
                           : 0;
 }
-long TaskQueue::getMaxEnqueueTime() const { return maxEnqueueTime; }
-long TaskQueue::getMinEnqueueTime() const { return minEnqueueTime; }
-long TaskQueue::getMaxDequeueTime() const { return maxDequeueTime; }
-long TaskQueue::getMinDequeueTime() const { return minDequeueTime; }
+long TaskQueue::getMaxEnqueueTime() const {
+  return ticksToMicroseconds(maxEnqueueTime);
+}
+long TaskQueue::getMinEnqueueTime() const {
+  return ticksToMicroseconds(minEnqueueTime);
+}
+long TaskQueue::getMaxDequeueTime() const {
+  return ticksToMicroseconds(maxDequeueTime);
+}
+long TaskQueue::getMinDequeueTime() const {
+  return ticksToMicroseconds(minDequeueTime);
+}
 
 int TaskQueue::getBlockCount() const {
   if (lockType == LockType::Mutex) {
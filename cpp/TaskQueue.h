@@ -6,21 +6,47 @@
 
 #include <chrono>
 #include <climits>
+#include <deque>
 #include <iostream>
+#include <memory_resource>
 #include <mutex>
 #include <pthread.h>
 #include <queue>
 #include <string>
+#include <string_view>
 
+// Allocator-aware: a std::pmr container of tasks constructs the name in
+// its own resource (uses-allocator construction), other tasks use the
+// default resource
 struct Task {
-  int id;
-  std::string name;
-  bool isCompleted;
+  using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+  int id = 0;
+  std::pmr::string name;
+  bool isCompleted = false;
+
+  Task() = default;
+  explicit Task(const allocator_type &alloc) : name(alloc) {}
+  Task(int id, std::string_view name, bool isCompleted,
+       const allocator_type &alloc = {})
+      : id(id), name(name, alloc), isCompleted(isCompleted) {}
+  Task(const Task &other, const allocator_type &alloc)
+      : id(other.id), name(other.name, alloc),
+        isCompleted(other.isCompleted) {}
+  Task(Task &&other, const allocator_type &alloc)
+      : id(other.id), name(std::move(other.name), alloc),
+        isCompleted(other.isCompleted) {}
+  Task(const Task &) = default;
+  Task(Task &&) = default;
+  Task &operator=(const Task &) = default;
+  Task &operator=(Task &&) = default;
 };
 
 class TaskQueue {
 private:
-  std::queue<Task> tasksQueue;
+  // storage and task names from the resource given to the constructor
+  std::pmr::memory_resource *resource;
+  std::queue<Task, std::pmr::deque<Task>> tasksQueue;
   LockType lockType; // type of lock, mutex or rwlock
   MutexLock *mutexLock;
   RWLock *rwLock;
@@ -29,7 +55,7 @@ private:
   pthread_cond_t cond;        // provide wait and signal functionality
   pthread_mutex_t queueMutex; // mutex for condition variable, for thread safety
 
-  // Benchmark data
+  // Benchmark data, times are CycleClock ticks, converted to us by getters
   std::atomic<long> totalEnqueueTime{0}; // Total enqueue operation time
   std::atomic<long> totalDequeueTime{0}; // Total dequeue operation time
   std::atomic<int> enqueueCount{0};      // Total enqueue operations
@@ -44,13 +70,21 @@ private:
   std::atomic<int> maxQueueLength{0};
 
 public:
-  TaskQueue(LockType type, void *lock = nullptr);
+  // resource backs the queue's storage, e.g. a pool per benchmark run; it
+  // is only used under the queue lock and must outlive the queue
+  TaskQueue(LockType type, void *lock = nullptr,
+            std::pmr::memory_resource *resource =
+                std::pmr::get_default_resource());
   ~TaskQueue(); // destructor
 
-  void lock();   // lock the queue, based on the lock type
+  // lock the queue, based on the lock type
+  // site tags the acquisition for LockProfiler (MutexLock only), untagged
+  // callers are keyed by their return address
+  void lock(const char *site = nullptr);
   void unlock(); // unlock the queue, based on the lock type
 
   void enqueue(const Task &t);
+  void enqueue(Task &&t); // the name is moved if t uses the queue's resource
   bool dequeue(Task &t);
   void dequeueAll();
 
@@ -7,6 +7,8 @@
 
 using namespace std;
 
+#include "../TaskQueue.h"
+#include "../util/LockProfiler.h"
 #include "../util/MutexLock.h"
 #include "../util/RWLock.h"
 
@@ -226,6 +228,116 @@ void testMutexContentionReset() {
             << std::endl;
 }
 
+// Test LockProfiler: per-call-site aggregation on a shared MutexLock
+void testLockProfilerSites() {
+  MutexLock mutex;
+  LockProfiler::reset();
+  LockProfiler::setEnabled(true);
+
+  auto hotSite = [&mutex]() {
+    for (int i = 0; i < 5; ++i) {
+      mutex.mutexLockOn("hot");
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      mutex.mutexUnlock();
+    }
+  };
+  auto coldSite = [&mutex]() {
+    for (int i = 0; i < 5; ++i) {
+      mutex.mutexLockOn("cold");
+      mutex.mutexUnlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  };
+
+  std::thread t1(hotSite);
+  std::thread t2(hotSite);
+  std::thread t3(coldSite);
+  t1.join();
+  t2.join();
+  t3.join();
+
+  mutex.mutexLockOn(); // untagged, keyed by return address
+  mutex.mutexUnlock();
+  LockProfiler::setEnabled(false);
+
+  auto report = LockProfiler::getReport();
+  assert(report.size() == 3);
+  long hotAcquisitions = 0;
+  for (const auto &stats : report) {
+    if (stats.site == "hot") {
+      hotAcquisitions = stats.acquisitions;
+      assert(stats.totalHoldNs >= 10 * 5000000L);
+    }
+  }
+  assert(hotAcquisitions == 10);
+  assert(report[0].totalWaitNs >= report[1].totalWaitNs); // sorted by wait
+  LockProfiler::printReport(std::cout);
+  std::cout << "[PASS] LockProfiler: Per-site stats aggregated as expected."
+            << std::endl;
+}
+
+// Test LockProfiler through a wrapper: untagged TaskQueue::lock calls are
+// keyed by their own call sites, not by one bucket for the wrapper
+void testLockProfilerWrapperSites() {
+  TaskQueue taskQueue(LockType::Mutex);
+  LockProfiler::reset();
+  LockProfiler::setEnabled(true);
+  taskQueue.lock(); // first untagged site
+  taskQueue.unlock();
+  taskQueue.lock(); // second untagged site
+  taskQueue.unlock();
+  LockProfiler::setEnabled(false);
+
+  auto report = LockProfiler::getReport();
+  assert(report.size() == 2);
+  for (const auto &stats : report) {
+    assert(stats.acquisitions == 1);
+    assert(stats.site != "TaskQueue::lock");
+  }
+  std::cout << "[PASS] LockProfiler: Wrapper callers keep their own sites."
+            << std::endl;
+}
+
+// Test LockProfiler across a condition wait: the time blocked in the wait
+// is waiting, not holding, and the reacquire is a second acquisition
+void testLockProfilerConditionWait() {
+  MutexLock mutex;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+  bool ready = false;
+  LockProfiler::reset();
+  LockProfiler::setEnabled(true);
+
+  std::thread signaller([&mutex, &cond, &ready]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    mutex.mutexLockOn("signal");
+    ready = true;
+    pthread_cond_signal(&cond);
+    mutex.mutexUnlock();
+  });
+  mutex.mutexLockOn("wait");
+  while (!ready) {
+    mutex.waitOnCondition(&cond);
+  }
+  mutex.mutexUnlock();
+  signaller.join();
+  LockProfiler::setEnabled(false);
+  pthread_cond_destroy(&cond);
+
+  bool found = false;
+  for (const auto &stats : LockProfiler::getReport()) {
+    if (stats.site == "wait") {
+      found = true;
+      assert(stats.acquisitions == 2);
+      assert(stats.contentions >= 1);
+      assert(stats.totalWaitNs >= 40000000L);
+      assert(stats.totalHoldNs < 40000000L);
+    }
+  }
+  assert(found);
+  std::cout << "[PASS] LockProfiler: Condition waits are not hold time."
+            << std::endl;
+}
+
 // Main function to run all tests
 int main() {
   std::cout << "Running all tests for MutexLock and RWLock..." << std::endl;
@@ -238,10 +350,14 @@ int main() {
   testRWLockReadWriteWithContention();
   testRWLockContentionReset();
   testMutexContentionReset();
+  testLockProfilerSites();
+  testLockProfilerWrapperSites();
+  testLockProfilerConditionWait();
 
   std::cout << "All tests passed!" << std::endl;
   return 0;
 }
 
-// g++ -std=c++17 -pthread -o LockTest LockTest.cpp ../util/MutexLock.cpp
+// g++ -std=c++17 -pthread -o LockTest LockTest.cpp ../util/MutexLock.cpp \
+//     ../util/RWlock.cpp ../util/LockProfiler.cpp
 // ../util/RWLock.cpp
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "../AsyncCSVWriter.h"
+#include "../CSVHandler.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Print separator for better test output
+void printSeparator(const std::string &testName) {
+  std::cout << "\n===== " << testName << " =====\n" << std::endl;
+}
+
+// rows from several threads all reach the file, flush makes them visible
+void testConcurrentStaging() {
+  printSeparator("Test AsyncCSVWriter concurrent staging");
+  CSVHandler csvHandler("test_async.csv", LockType::RWLock);
+  AsyncCSVWriter writer(csvHandler, 4096);
+
+  std::vector<std::thread> consumers;
+  for (int t = 0; t < 4; ++t) {
+    consumers.emplace_back([&writer, t] {
+      for (int i = 0; i < 1000; ++i) {
+        int id = t * 1000 + i;
+        assert(writer.writeRow({std::to_string(id),
+                                "Task_" + std::to_string(id), "Complete"}));
+      }
+    });
+  }
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+  writer.flush();
+
+  std::vector<bool> seen(4000, false);
+  CSVTable table = csvHandler.readTable();
+  assert(table.rowCount() == 4000);
+  for (CSVRow row : table) {
+    int id = std::stoi(std::string(row[0]));
+    assert(!seen[id]);
+    seen[id] = true;
+    assert(row[1] == "Task_" + std::to_string(id));
+  }
+  assert(csvHandler.rowCount() == 4000);
+  // 4 KB buffers hold about 170 rows, so the rows went out in batches
+  assert(writer.getBatchSizeHistogram().getCount() > 1);
+  assert(writer.getBatchSizeHistogram().getSum() == 4000);
+  // each fresh thread timed one call in kLatencySampleEvery
+  assert(writer.getStageLatencyHistogram().getCount() ==
+         4 * (1000 / AsyncCSVWriter::kLatencySampleEvery));
+  std::cout << "Concurrent staging test passed." << std::endl;
+}
+
+// close drains the staged rows, later writes throw
+void testCloseDrains() {
+  printSeparator("Test AsyncCSVWriter close");
+  CSVHandler csvHandler("test_async_close.csv");
+  {
+    AsyncCSVWriter writer(csvHandler);
+    for (int i = 0; i < 500; ++i) {
+      writer.writeRow({std::to_string(i), "Task, \"quoted\"", "Complete"});
+    }
+    writer.close();
+    bool threw = false;
+    try {
+      writer.writeRow({"500", "Task", "Complete"});
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw);
+  }
+  auto rows = csvHandler.readAll();
+  assert(rows.size() == 500);
+  assert(rows[499][1] == "Task, \"quoted\"");
+
+  // the destructor also drains
+  {
+    AsyncCSVWriter writer(csvHandler);
+    writer.writeRow({"500", "Task", "Complete"});
+  }
+  assert(csvHandler.rowCount() == 501);
+  std::cout << "Close test passed." << std::endl;
+}
+
+// a full buffer drops rows under DropNewest and blocks under Block
+void testQueueFullPolicies() {
+  printSeparator("Test AsyncCSVWriter queue-full policies");
+  CSVHandler csvHandler("test_async_full.csv");
+  // slow sink: every batch is synced to the device
+  csvHandler.setDurability(Durability::FDataSync);
+
+  long accepted = 0;
+  {
+    AsyncCSVWriter writer(csvHandler, 64, QueueFullPolicy::DropNewest);
+    for (int i = 0; i < 5000; ++i) {
+      if (writer.writeRow({std::to_string(i), "Task", "Complete"})) {
+        accepted++;
+      }
+    }
+    writer.flush();
+    assert(accepted + writer.getRowsDropped() == 5000);
+    assert(writer.getFullWaits() == 0);
+  }
+  assert(csvHandler.rowCount() == accepted);
+  std::cout << "DropNewest kept " << accepted << " of 5000 rows" << std::endl;
+
+  csvHandler.clear();
+  {
+    AsyncCSVWriter writer(csvHandler, 64, QueueFullPolicy::Block);
+    for (int i = 0; i < 2000; ++i) {
+      assert(writer.writeRow({std::to_string(i), "Task", "Complete"}));
+    }
+    writer.flush();
+    assert(writer.getRowsDropped() == 0);
+  }
+  assert(csvHandler.rowCount() == 2000);
+  std::cout << "Queue-full policy test passed." << std::endl;
+}
+
+int main() {
+  testConcurrentStaging();
+  testCloseDrains();
+  testQueueFullPolicies();
+  std::cout << "\nAll AsyncCSVWriter tests passed." << std::endl;
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "../BinaryLogHandler.h"
+#include "../CSVHandler.h"
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Print separator for better test output
+void printSeparator(const std::string &testName) {
+  std::cout << "\n===== " << testName << " =====\n" << std::endl;
+}
+
+// rows survive the encode/decode round trip, open block included
+void testRoundTrip(LockType lockType) {
+  printSeparator("Test BinaryLogHandler round trip");
+  const std::string path = "test_binary.log";
+  std::vector<std::vector<std::string>> expected;
+  {
+    BinaryLogHandler log(path, lockType);
+    log.setBlockRows(4);
+    for (int i = 0; i < 10; ++i) {
+      std::vector<std::string> row = {std::to_string(i),
+                                      "Task " + std::to_string(i % 3),
+                                      i % 2 == 0 ? "Complete" : "Incomplete"};
+      log.writeRow(row);
+      expected.push_back(row);
+    }
+    // two blocks written, two rows still buffered
+    assert(log.readAll() == expected);
+    log.writeRecord(-7, "Task, \"quoted\"", "Complete");
+    expected.push_back({"-7", "Task, \"quoted\"", "Complete"});
+  }
+  // destructor wrote the open block
+  std::vector<std::vector<std::string>> decoded;
+  long records = BinaryLogHandler::readFile(
+      path, [&decoded](long id, std::string_view name,
+                       std::string_view status) {
+        decoded.push_back(
+            {std::to_string(id), std::string(name), std::string(status)});
+      });
+  assert(records == 11);
+  assert(decoded == expected);
+
+  BinaryLogHandler log(path, lockType);
+  assert(log.readAll().empty()); // constructor truncates
+  bool threw = false;
+  try {
+    log.writeRow({"not a number", "Task", "Complete"});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Round trip test passed." << std::endl;
+}
+
+// concurrent writers, every record lands exactly once
+void testConcurrentWriters() {
+  printSeparator("Test BinaryLogHandler concurrent writers");
+  BinaryLogHandler log("test_binary_concurrent.log", LockType::RWLock);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&log, t] {
+      for (int i = 0; i < 500; ++i) {
+        log.writeRecord(t * 1000 + i, "Task", "Complete");
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  log.flush();
+  std::vector<bool> seen(4000, false);
+  for (const auto &row : log.readAll()) {
+    int id = std::stoi(row[0]);
+    assert(!seen[id]);
+    seen[id] = true;
+  }
+  assert(log.readAll().size() == 2000);
+  std::cout << "Concurrent writers test passed." << std::endl;
+}
+
+// CSV -> binary -> CSV gives back the same rows
+void testConverters() {
+  printSeparator("Test BinaryLogHandler converters");
+  std::vector<std::vector<std::string>> rows;
+  {
+    CSVHandler csv("test_binary_source.csv");
+    for (int i = 0; i < 2500; ++i) {
+      rows.push_back({std::to_string(i), "Task " + std::to_string(i),
+                      i % 5 == 0 ? "Incomplete" : "Complete"});
+      csv.writeRow(rows.back());
+    }
+  }
+  assert(BinaryLogHandler::convertFromCSV("test_binary_source.csv",
+                                          "test_binary_converted.log") ==
+         2500);
+  assert(BinaryLogHandler::convertToCSV("test_binary_converted.log",
+                                        "test_binary_roundtrip.csv") == 2500);
+  std::ifstream in("test_binary_roundtrip.csv");
+  std::string contents((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+  CSVTable table(contents);
+  assert(table.toVectors() == rows);
+  std::cout << "Converter test passed." << std::endl;
+}
+
+// a flipped byte fails the checksum, a torn tail is ignored
+void testCorruption() {
+  printSeparator("Test BinaryLogHandler corruption");
+  const std::string path = "test_binary_corrupt.log";
+  {
+    BinaryLogHandler log(path);
+    log.setBlockRows(100);
+    for (int i = 0; i < 250; ++i) {
+      log.writeRecord(i, "Task", "Complete");
+    }
+  }
+  auto count = [&path] {
+    return BinaryLogHandler::readFile(
+        path, [](long, std::string_view, std::string_view) {});
+  };
+  assert(count() == 250);
+
+  std::string contents;
+  {
+    std::ifstream in(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  // torn last block: the first two blocks are still readable
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 5);
+  }
+  assert(count() == 200);
+
+  // flipped payload byte in the first block
+  std::string corrupt = contents;
+  corrupt[40] ^= 0x01;
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(corrupt.data(), corrupt.size());
+  }
+  bool threw = false;
+  try {
+    count();
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+  std::cout << "Corruption test passed." << std::endl;
+}
+
+int main() {
+  testRoundTrip(LockType::Mutex);
+  testRoundTrip(LockType::RWLock);
+  testConcurrentWriters();
+  testConverters();
+  testCorruption();
+  std::cout << "\nAll binary log tests passed." << std::endl;
+  return 0;
+}
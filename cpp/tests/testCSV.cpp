@@ -1,7 +1,16 @@
 #include "../CSVHandler.h"
+#include "../util/AllocationCounter.h"
+#include "../util/CSVParser.h"
+#include "../util/RowIndex.h"
+#include <atomic>
 #include <cassert>
+#include <csignal>
+#include <filesystem>
 #include <iostream>
+#include <memory_resource>
+#include <sys/resource.h>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -81,6 +90,819 @@ void testCSVHandlerWithLockTypeOnSameFile(LockType lockType,
             << "] File cleared and verified successfully." << std::endl;
 }
 
+// Test buffered writes: rows become visible according to the flush policy
+void testFlushPolicies() {
+  printSeparator("Test CSVHandler flush policies");
+
+  const std::string testFilePath = "test_flush.csv";
+  {
+    CSVHandler csvHandler(testFilePath, LockType::Mutex);
+
+    csvHandler.setFlushPolicy(FlushPolicy::EveryNRows, 3);
+    csvHandler.writeRow({"1", "Task1", "Complete"});
+    csvHandler.writeRow({"2", "Task2", "Complete"});
+    assert(csvHandler.readAll().empty()); // still buffered
+    csvHandler.writeRow({"3", "Task3", "Complete"});
+    assert(csvHandler.readAll().size() == 3);
+
+    csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 64);
+    csvHandler.writeRow({"4", "Task4", "Complete"});
+    assert(csvHandler.readAll().size() == 3);
+    for (int i = 5; i <= 8; ++i) {
+      csvHandler.writeRow(
+          {std::to_string(i), "Task" + std::to_string(i), "Complete"});
+    }
+    assert(csvHandler.readAll().size() >= 6);
+
+    csvHandler.setFlushPolicy(FlushPolicy::OnClose);
+    csvHandler.writeRow({"9", "Task9", "Complete"});
+    csvHandler.flush();
+    assert(csvHandler.readAll().size() == 9);
+
+    csvHandler.writeRow({"10", "Task10", "Complete"}); // flushed on close
+  }
+
+  std::ifstream file(testFilePath);
+  std::string line;
+  int lines = 0;
+  while (std::getline(file, line)) {
+    lines++;
+  }
+  assert(lines == 10);
+
+  // Interval: rows left behind when writes stop still reach the file
+  CSVHandler intervalHandler("test_flush_interval.csv", LockType::Mutex);
+  intervalHandler.setFlushPolicy(FlushPolicy::Interval, 20);
+  intervalHandler.writeRow({"1", "Task1", "Complete"});
+  intervalHandler.writeRow({"2", "Task2", "Complete"});
+  for (int i = 0; i < 100 && intervalHandler.readAll().size() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(intervalHandler.readAll().size() == 2);
+  std::cout << "[Test-Flush] Flush policies verified successfully."
+            << std::endl;
+}
+
+// Test group commit: concurrent writers share batched write + fdatasync
+void testGroupCommit(Durability durability, const std::string &name) {
+  printSeparator("Test CSVHandler group commit: " + name);
+
+  CSVHandler csvHandler("test_group_commit.csv", LockType::Mutex);
+  csvHandler.setDurability(durability);
+
+  const int writerCount = 8;
+  const int rowsPerWriter = 50;
+  std::vector<std::thread> writers;
+  for (int i = 0; i < writerCount; ++i) {
+    writers.emplace_back([&csvHandler, i]() {
+      for (int j = 0; j < rowsPerWriter; ++j) {
+        csvHandler.writeRow({std::to_string(i), std::to_string(j), "Complete"});
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  // every row is visible once writeRow returned
+  assert(csvHandler.readAll().size() == writerCount * rowsPerWriter);
+
+  const Histogram &batches = csvHandler.getBatchSizeHistogram();
+  assert(batches.getSum() == writerCount * rowsPerWriter);
+  if (durability == Durability::FDataSync) {
+    assert(csvHandler.getSyncLatencyHistogram().getCount() ==
+           batches.getCount());
+  } else {
+    assert(csvHandler.getSyncLatencyHistogram().getCount() == 0);
+  }
+  std::cout << "[Test-GroupCommit] " << batches.getCount()
+            << " batches, sizes: " << batches.toString() << std::endl;
+}
+
+// Test group commit failures: with every write failing, batches fail back
+// to back while followers of earlier batches are still waking up; each of
+// them must still throw for its own row
+void testGroupCommitFailures() {
+  printSeparator("Test CSVHandler group commit failures");
+
+  CSVHandler csvHandler("test_group_commit_failures.csv", LockType::Mutex);
+  csvHandler.clear();
+  csvHandler.setDurability(Durability::Flush);
+
+  // no file may grow: write(2) fails with EFBIG instead of SIGXFSZ
+  struct rlimit previousLimit;
+  getrlimit(RLIMIT_FSIZE, &previousLimit);
+  struct rlimit noGrowth = previousLimit;
+  noGrowth.rlim_cur = 0;
+  auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+  setrlimit(RLIMIT_FSIZE, &noGrowth);
+
+  // holding the file lock now and then lets followers pile up behind the
+  // leaders, so batches have several rows and fail in quick succession
+  std::atomic<bool> writing{true};
+  std::thread lockHolder([&csvHandler, &writing]() {
+    while (writing) {
+      csvHandler.getMutexLock()->mutexLockOn("test::holdFileLock");
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      csvHandler.getMutexLock()->mutexUnlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+
+  const int writerCount = 8;
+  const int rowsPerWriter = 50;
+  std::atomic<int> failures{0};
+  std::atomic<int> successes{0};
+  std::vector<std::thread> writers;
+  for (int i = 0; i < writerCount; ++i) {
+    writers.emplace_back([&csvHandler, &failures, &successes, i]() {
+      for (int j = 0; j < rowsPerWriter; ++j) {
+        try {
+          csvHandler.writeRow(i, "Task", true);
+          successes++;
+        } catch (const std::runtime_error &) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  writing = false;
+  lockHolder.join();
+
+  setrlimit(RLIMIT_FSIZE, &previousLimit);
+  std::signal(SIGXFSZ, previousHandler);
+
+  assert(successes == 0);
+  assert(failures == writerCount * rowsPerWriter);
+  assert(csvHandler.readAll().empty());
+  assert(csvHandler.getBatchSizeHistogram().getMax() > 1);
+  std::cout << "[Test-GroupCommit] " << failures.load() << " rows in "
+            << csvHandler.getBatchSizeHistogram().getCount()
+            << " failed batches, all reported." << std::endl;
+}
+
+// Test lock-free append mode: concurrent rows never interleave
+void testAtomicAppend() {
+  printSeparator("Test CSVHandler atomic append mode");
+
+  CSVHandler csvHandler("test_atomic_append.csv", LockType::Mutex);
+  csvHandler.setWriteMode(WriteMode::AtomicAppend);
+
+  const int writerCount = 8;
+  const int rowsPerWriter = 200;
+  std::vector<std::thread> writers;
+  for (int i = 0; i < writerCount; ++i) {
+    writers.emplace_back([&csvHandler, i]() {
+      for (int j = 0; j < rowsPerWriter; ++j) {
+        csvHandler.writeRow({"Writer_" + std::to_string(i),
+                             "Row_" + std::to_string(j), "Complete"});
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  auto rows = csvHandler.readAll();
+  assert(rows.size() == writerCount * rowsPerWriter);
+  for (const auto &row : rows) {
+    assert(row.size() == 3 && row[2] == "Complete");
+  }
+  assert(csvHandler.getMutexContention() == 0); // writers never locked
+
+  // a short write is an error, not finished with a second write(2)
+  long fileSize = std::filesystem::file_size("test_atomic_append.csv");
+  struct rlimit previousLimit;
+  getrlimit(RLIMIT_FSIZE, &previousLimit);
+  struct rlimit nearlyFull = previousLimit;
+  nearlyFull.rlim_cur = fileSize + 4; // room for part of one row
+  auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+  setrlimit(RLIMIT_FSIZE, &nearlyFull);
+  bool threw = false;
+  try {
+    csvHandler.writeRow({"Writer_short", "Row_short", "Complete"});
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  setrlimit(RLIMIT_FSIZE, &previousLimit);
+  std::signal(SIGXFSZ, previousHandler);
+  assert(threw);
+  assert(static_cast<long>(
+             std::filesystem::file_size("test_atomic_append.csv")) ==
+         fileSize + 4);
+  std::cout << "[Test-AtomicAppend] Rows intact without a write lock."
+            << std::endl;
+}
+
+// Test incremental reads: each call returns only rows added since the cursor
+void testReadSince() {
+  printSeparator("Test CSVHandler readSince");
+
+  const std::string testFilePath = "test_read_since.csv";
+  CSVHandler csvHandler(testFilePath, LockType::RWLock);
+  CSVCursor cursor;
+
+  csvHandler.writeRow({"1", "Task1", "Complete"});
+  csvHandler.writeRow({"2", "Task2", "Complete"});
+  csvHandler.writeRow({"3", "Task3", "Complete"});
+  auto rows = csvHandler.readSince(cursor);
+  assert(rows.size() == 3 && cursor.rowsRead == 3);
+  assert(csvHandler.readSince(cursor).empty());
+
+  csvHandler.writeRow({"4", "Task4", "Complete"});
+  rows = csvHandler.readSince(cursor);
+  assert(rows.size() == 1);
+  assert(rows[0] == std::vector<std::string>({"4", "Task4", "Complete"}));
+
+  // a partial row stays unread until its newline arrives
+  {
+    std::ofstream partial(testFilePath, std::ios::app);
+    partial << "5,Task5";
+  }
+  assert(csvHandler.readSince(cursor).empty());
+  {
+    std::ofstream rest(testFilePath, std::ios::app);
+    rest << ",Complete\n";
+  }
+  rows = csvHandler.readSince(cursor);
+  assert(rows.size() == 1 && rows[0][2] == "Complete");
+  assert(cursor.rowsRead == 5);
+
+  // truncation restarts the cursor
+  csvHandler.clear();
+  csvHandler.writeRow({"6", "Task6", "Complete"});
+  rows = csvHandler.readSince(cursor);
+  assert(rows.size() == 1 && cursor.rowsRead == 1);
+
+  // cleared and grown past the old offset between two reads: the cursor
+  // still restarts instead of resuming in the middle of a row
+  csvHandler.clear();
+  for (int i = 0; i < 5; ++i) {
+    csvHandler.writeRow({std::to_string(10 + i), "Task_after_clear", "Done"});
+  }
+  rows = csvHandler.readSince(cursor);
+  assert(rows.size() == 5 && cursor.rowsRead == 5);
+  assert(rows[0] ==
+         std::vector<std::string>({"10", "Task_after_clear", "Done"}));
+  std::cout << "[Test-ReadSince] Incremental reads verified." << std::endl;
+}
+
+// Test mmap reads: same rows as the stream path, including after growth
+void testMmapRead() {
+  printSeparator("Test CSVHandler mmap read mode");
+
+  const std::string testFilePath = "test_mmap_read.csv";
+  CSVHandler csvHandler(testFilePath, LockType::RWLock);
+  csvHandler.clear();
+  csvHandler.setReadMode(ReadMode::Mmap);
+  assert(csvHandler.readAll().empty()); // empty file maps nothing
+
+  csvHandler.writeRow({"1", "Task1", "Complete"});
+  csvHandler.writeRow({"2", "", "Pending"});
+  csvHandler.writeRow({"3", "Task3", ""});
+  auto mapped = csvHandler.readAll();
+
+  csvHandler.writeRow({"4", "Task4", "Complete"}); // file grows, remap
+  auto grown = csvHandler.readAll();
+
+  csvHandler.setReadMode(ReadMode::Stream);
+  auto streamed = csvHandler.readAll();
+  assert(grown == streamed);
+  assert(mapped.size() == 3 && grown.size() == 4);
+  assert(grown[1] == std::vector<std::string>({"2", "", "Pending"}));
+  assert(grown[2] == std::vector<std::string>({"3", "Task3"}));
+  std::cout << "[Test-MmapRead] Mmap and stream reads match." << std::endl;
+}
+
+// Test row views: readTable matches readAll without copying cells
+void testReadTable() {
+  printSeparator("Test CSVHandler readTable views");
+
+  CSVHandler csvHandler("test_read_table.csv", LockType::RWLock);
+  csvHandler.writeRow({"1", "A", "Complete"});
+  csvHandler.writeRow({"2", "B", "Pending"});
+
+  for (ReadMode mode : {ReadMode::Stream, ReadMode::Mmap}) {
+    csvHandler.setReadMode(mode);
+    CSVTable table = csvHandler.readTable();
+    CSVTable moved = std::move(table); // views stay valid after a move
+    assert(moved.rowCount() == 2);
+    assert(moved[1][1] == "B" && moved[1].size() == 3);
+
+    size_t rowIndex = 0;
+    for (CSVRow row : moved) {
+      assert(row.toVector() == csvHandler.readAll()[rowIndex]);
+      rowIndex++;
+    }
+    assert(rowIndex == 2);
+  }
+  std::cout << "[Test-ReadTable] Row views match readAll." << std::endl;
+}
+
+// Test RFC 4180 quoting: every tokenizer kernel reads back quoted cells
+void testQuotedFields() {
+  printSeparator("Test CSVHandler quoted fields");
+
+  CSVHandler csvHandler("test_quoted.csv", LockType::RWLock);
+  csvHandler.clear();
+  const std::vector<std::vector<std::string>> expected = {
+      {"1", "Task, with comma", "Complete"},
+      {"2", "say \"hi\"", "Pending"},
+      {"3", "two\nlines", "Complete"},
+      {"4", "plain", "Complete"}};
+  // long enough that quoted fields cross the 64-byte blocks
+  for (int i = 0; i < 20; ++i) {
+    for (const auto &row : expected) {
+      csvHandler.writeRow(row);
+    }
+  }
+
+  for (CSVParser::Kernel kernel :
+       {CSVParser::Kernel::Scalar, CSVParser::Kernel::SSE2,
+        CSVParser::Kernel::AVX2}) {
+    if (!CSVParser::isSupported(kernel)) {
+      continue;
+    }
+    CSVParser::setKernel(kernel);
+    auto rows = csvHandler.readAll();
+    assert(rows.size() == expected.size() * 20);
+    for (size_t i = 0; i < rows.size(); ++i) {
+      assert(rows[i] == expected[i % expected.size()]);
+    }
+  }
+  CSVParser::setKernel(CSVParser::Kernel::Auto);
+  std::cout << "[Test-Quoted] Quoted fields round-trip with every kernel."
+            << std::endl;
+}
+
+// Test parallel parsing: chunked reads match a serial read row for row
+void testParallelRead() {
+  printSeparator("Test CSVHandler parallel read");
+
+  CSVHandler csvHandler("test_parallel.csv", LockType::RWLock);
+  csvHandler.clear();
+  csvHandler.setFlushPolicy(FlushPolicy::OnClose);
+  // large enough to be split, with quoted newlines near chunk boundaries
+  for (int i = 0; i < 40000; ++i) {
+    csvHandler.writeRow({std::to_string(i),
+                         i % 7 == 0 ? "multi\nline, \"quoted\"" : "Task",
+                         "Complete"});
+  }
+  csvHandler.flush();
+
+  csvHandler.setReadMode(ReadMode::Mmap);
+  auto serial = csvHandler.readAll();
+  for (int threads : {2, 3, 8}) {
+    csvHandler.setReadThreads(threads);
+    assert(csvHandler.readAll() == serial);
+  }
+  assert(serial.size() == 40000 && serial[7][1] == "multi\nline, \"quoted\"");
+  std::cout << "[Test-ParallelRead] Parallel reads match the serial read."
+            << std::endl;
+}
+
+// Test streaming reads: fixed buffer, same rows as readAll, early exit
+void testForEachRow() {
+  printSeparator("Test CSVHandler forEachRow and row reader");
+
+  CSVHandler csvHandler("test_for_each.csv", LockType::RWLock);
+  csvHandler.clear();
+  csvHandler.setFlushPolicy(FlushPolicy::OnClose);
+  for (int i = 0; i < 20000; ++i) {
+    csvHandler.writeRow({std::to_string(i), i % 5 == 0 ? "a,\"b\"" : "Task",
+                         "Complete"});
+  }
+  csvHandler.flush();
+  auto expected = csvHandler.readAll();
+
+  size_t index = 0;
+  long visited = csvHandler.forEachRow([&](const CSVRow &row) {
+    assert(row.toVector() == expected[index]);
+    index++;
+    return true;
+  });
+  assert(visited == 20000 && index == expected.size());
+
+  // stop as soon as task 123 is found
+  visited = csvHandler.forEachRow(
+      [](const CSVRow &row) { return row[0] != "123"; });
+  assert(visited == 124);
+
+  // the pull reader keeps its small buffer for a file many times larger
+  CSVRowReader reader = csvHandler.openRowReader(1024);
+  index = 0;
+  for (const CSVRow &row : reader) {
+    assert(row.toVector() == expected[index]);
+    index++;
+  }
+  assert(index == expected.size() && reader.getBufferSize() == 1024);
+  std::cout << "[Test-ForEachRow] Streaming reads verified." << std::endl;
+}
+
+// Test filtered reads: projection and predicates applied during the scan
+void testQuery() {
+  printSeparator("Test CSVHandler query reads");
+
+  CSVHandler csvHandler("test_query.csv", LockType::RWLock);
+  csvHandler.clear();
+  for (int i = 0; i < 1000; ++i) {
+    std::string name = "Task, \"" + std::to_string(i) + "\"";
+    csvHandler.writeRow(
+        {std::to_string(i), name, i % 3 == 0 ? "Complete" : "Incomplete"});
+  }
+  csvHandler.writeRow({"1000", "no status"}); // missing predicate column
+
+  CSVQuery completed;
+  completed.select({0, 2}).whereEquals(2, "Complete");
+  CSVTable table = csvHandler.readTable(completed);
+  assert(table.rowCount() == 334);
+  for (CSVRow row : table) {
+    assert(row.size() == 2 && row[1] == "Complete");
+    assert(std::stoi(std::string(row[0])) % 3 == 0);
+  }
+
+  CSVQuery range;
+  range.whereBetween(0, 10, 19).whereEquals(2, "Incomplete");
+  auto rows = csvHandler.readTable(range).toVectors();
+  assert(rows.size() == 7); // 10 11 13 14 16 17 19
+  assert(rows[0] == std::vector<std::string>({"10", "Task, \"10\"",
+                                              "Incomplete"}));
+
+  long matches = csvHandler.forEachRow(range, [](const CSVRow &row) {
+    return row[0] != "13";
+  });
+  assert(matches == 3);
+  std::cout << "[Test-Query] Projection and predicates verified."
+            << std::endl;
+}
+
+// Test the row index: counts and seeks in every write path, rebuild, clear
+void testRowIndex() {
+  printSeparator("Test CSVHandler row index");
+
+  const std::string testFilePath = "test_row_index.csv";
+  CSVHandler csvHandler(testFilePath, LockType::RWLock);
+  auto writeRows = [&csvHandler](int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+      csvHandler.writeRow({std::to_string(i),
+                           i % 4 == 0 ? "line\nbreak" : "Task", "Complete"});
+    }
+  };
+
+  csvHandler.setFlushPolicy(FlushPolicy::EveryNRows, 8);
+  writeRows(0, 20);
+  assert(csvHandler.rowCount() == 16); // 4 rows still buffered
+  csvHandler.flush();
+  assert(csvHandler.rowCount() == 20);
+
+  csvHandler.setDurability(Durability::Flush); // group commit path
+  writeRows(20, 10);
+  csvHandler.setDurability(Durability::None);
+  csvHandler.setWriteMode(WriteMode::AtomicAppend);
+  writeRows(30, 10);
+  assert(csvHandler.rowCount() == 40);
+  csvHandler.setWriteMode(WriteMode::Locked);
+
+  assert(csvHandler.readRow(0)[0] == "0");
+  assert(csvHandler.readRow(36)[1] == "line\nbreak");
+  CSVTable range = csvHandler.readRange(18, 33);
+  assert(range.rowCount() == 15 && range[0][0] == "18" &&
+         range[14][0] == "32");
+  bool threw = false;
+  try {
+    csvHandler.readRow(40);
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  assert(threw);
+
+  // rows appended behind the handler's back show up after a rebuild
+  {
+    std::ofstream external(testFilePath, std::ios::app);
+    external << "40,External,Complete\n";
+  }
+  csvHandler.rebuildIndex();
+  assert(csvHandler.rowCount() == 41);
+  assert(csvHandler.readRow(40)[1] == "External");
+
+  csvHandler.clear();
+  assert(csvHandler.rowCount() == 0);
+
+  // a row split across two appends, inside a quoted field, is indexed at
+  // its own start once the rest arrives
+  RowIndex index;
+  index.append("1,a\n2,\"b", 8);
+  assert(index.getRowCount() == 1 && index.getIndexedBytes() == 4);
+  index.append("\nc\"\n3,d\n", 8);
+  long begin = 0;
+  long end = 0;
+  assert(index.getRowCount() == 3);
+  assert(index.getRange(1, 2, begin, end) && begin == 4 && end == 12);
+  assert(index.getRange(2, 3, begin, end) && begin == 12 && end == 16);
+  std::cout << "[Test-RowIndex] Row index verified." << std::endl;
+}
+
+// Test the snapshot cache: shared parse, incremental extension, clear
+void testSnapshot() {
+  printSeparator("Test CSVHandler snapshot cache");
+
+  CSVHandler csvHandler("test_snapshot.csv", LockType::RWLock);
+  csvHandler.clear();
+  for (int i = 0; i < 100; ++i) {
+    csvHandler.writeRow({std::to_string(i), "Task", "Complete"});
+  }
+
+  // concurrent readers of the same length share a single parse
+  std::vector<std::thread> readers;
+  std::vector<std::shared_ptr<const CSVSnapshot>> seen(8);
+  for (int i = 0; i < 8; ++i) {
+    readers.emplace_back(
+        [&csvHandler, &seen, i]() { seen[i] = csvHandler.getSnapshot(); });
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  for (const auto &snapshot : seen) {
+    assert(snapshot == seen[0] && snapshot->rowCount() == 100);
+  }
+  assert(csvHandler.getSnapshotRebuilds() == 1);
+  assert(csvHandler.getSnapshotHits() == 7);
+
+  // appends only parse the new rows, the old snapshot stays unchanged
+  csvHandler.writeRow({"100", "Task", "Complete"});
+  auto extended = csvHandler.getSnapshot();
+  assert(csvHandler.getSnapshotExtensions() == 1);
+  assert(extended->rowCount() == 101 && seen[0]->rowCount() == 100);
+  assert((*extended)[100][0] == "100" && (*extended)[42][0] == "42");
+  assert(extended->toVectors() == csvHandler.readAll());
+
+  // a long chain of appends is merged, never parsed again from the start;
+  // cells rewritten from "" escapes survive the merges
+  for (int i = 101; i < 1101; ++i) {
+    csvHandler.writeRow({std::to_string(i), "Task \"" + std::to_string(i) +
+                                                "\", quoted",
+                         "Complete"});
+    auto snapshot = csvHandler.getSnapshot();
+    assert(snapshot->getSegmentCount() <= 12);
+  }
+  auto merged = csvHandler.getSnapshot();
+  assert(csvHandler.getSnapshotRebuilds() == 1);
+  assert(merged->rowCount() == 1101);
+  assert((*merged)[1000][1] == "Task \"1000\", quoted");
+  assert(merged->toVectors() == csvHandler.readAll());
+
+  csvHandler.clear();
+  csvHandler.writeRow({"0", "Task", "Complete"});
+  assert(csvHandler.getSnapshot()->rowCount() == 1);
+  assert(csvHandler.getSnapshotRebuilds() == 2);
+  std::cout << "[Test-Snapshot] Snapshot cache verified." << std::endl;
+}
+
+// Test the io_uring backend: same file contents and reads as synchronous I/O
+void testIOUringBackend() {
+  printSeparator("Test CSVHandler io_uring backend");
+
+  CSVHandler csvHandler("test_uring.csv", LockType::RWLock);
+  csvHandler.clear();
+  csvHandler.setIOBackend(IOBackend::Uring);
+  if (csvHandler.getIOBackend() != IOBackend::Uring) {
+    std::cout << "[Test-Uring] io_uring unavailable, skipped." << std::endl;
+    return;
+  }
+
+  // buffered rows are written in one request larger than a ring chunk
+  csvHandler.setFlushPolicy(FlushPolicy::OnClose);
+  std::vector<std::vector<std::string>> expected;
+  for (int i = 0; i < 40000; ++i) {
+    expected.push_back({std::to_string(i), "Task_" + std::to_string(i),
+                        i % 2 == 0 ? "Complete" : "Incomplete"});
+    csvHandler.writeRow(expected.back());
+  }
+  csvHandler.flush();
+  // group-committed rows land after them
+  csvHandler.setDurability(Durability::Flush);
+  for (int i = 40000; i < 40010; ++i) {
+    expected.push_back({std::to_string(i), "Task", "Complete"});
+    csvHandler.writeRow(expected.back());
+  }
+  assert(csvHandler.readAll() == expected);
+  assert(csvHandler.rowCount() == 40010);
+  assert(csvHandler.readRow(39999)[1] == "Task_39999");
+  assert(csvHandler.readRange(100, 40010).rowCount() == 39910);
+
+  // the file is the same one synchronous I/O reads
+  csvHandler.setIOBackend(IOBackend::Sync);
+  assert(csvHandler.readAll() == expected);
+  std::cout << "[Test-Uring] io_uring writes and reads verified."
+            << std::endl;
+}
+
+// O_DIRECT writes: rows straddle block boundaries, the partial last block
+// is written padded on flush and cut back to the real file size
+void testDirectIOBackend() {
+  printSeparator("Test CSVHandler O_DIRECT backend");
+
+  CSVHandler csvHandler("test_direct.csv", LockType::Mutex);
+  csvHandler.clear();
+  csvHandler.setIOBackend(IOBackend::Direct);
+  if (csvHandler.getIOBackend() != IOBackend::Direct) {
+    std::cout << "[Test-Direct] O_DIRECT unavailable, skipped." << std::endl;
+    return;
+  }
+  csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 10000);
+  std::vector<std::vector<std::string>> expected;
+  for (int i = 0; i < 100000; ++i) {
+    expected.push_back({std::to_string(i), "Task_" + std::to_string(i),
+                        i % 2 == 0 ? "Complete" : "Incomplete"});
+    csvHandler.writeRow(expected.back());
+  }
+  csvHandler.flush();
+  assert(csvHandler.getDirectBytes() % 4096 == 0);
+  assert(csvHandler.getDirectBytes() > csvHandler.getBufferedBytes());
+  assert(csvHandler.readAll() == expected);
+  assert(csvHandler.readRow(99999)[1] == "Task_99999");
+
+  long fileSize = std::filesystem::file_size("test_direct.csv");
+  assert(fileSize % 4096 != 0); // the padding was cut off
+
+  // per-row writes only fill the staged block until it is complete
+  csvHandler.setFlushPolicy(FlushPolicy::PerRow);
+  expected.push_back({"100000", "Task, \"last\"", "Complete"});
+  csvHandler.writeRow(expected.back());
+  assert(csvHandler.rowCount() == 100000);
+  csvHandler.flush();
+  assert(csvHandler.readAll() == expected);
+  assert(csvHandler.getBufferedBytes() == 0);
+
+  // rows written without O_DIRECT in between: the partial block is read
+  // back from the file before the next direct write
+  csvHandler.setIOBackend(IOBackend::Sync);
+  expected.push_back({"100001", "Task", "Complete"});
+  csvHandler.writeRow(expected.back());
+  csvHandler.setIOBackend(IOBackend::Direct);
+  expected.push_back({"100002", "Task", "Complete"});
+  csvHandler.writeFormatted("100002,Task,Complete\n", 1);
+  csvHandler.flush();
+  assert(csvHandler.readAll() == expected);
+
+  // after clear() the staged block is dropped with the file contents
+  csvHandler.writeRow({"100003", "Task", "Complete"});
+  csvHandler.clear();
+  csvHandler.writeRow({"0", "Task", "Complete"});
+  csvHandler.flush();
+  assert(csvHandler.readAll().size() == 1);
+  std::cout << "[Test-Direct] O_DIRECT writes and reads verified."
+            << std::endl;
+}
+
+// typed rows match the vector<string> format and stop allocating once the
+// buffers have grown
+void testTypedWriteRow() {
+  printSeparator("Test CSVHandler typed writeRow");
+
+  std::string typed;
+  std::string generic;
+  CSVHandler::formatRow(typed, -42, "Task, \"quoted\"", false);
+  CSVHandler::formatRow(generic, {"-42", "Task, \"quoted\"", "Incomplete"});
+  assert(typed == generic);
+
+  CSVHandler csvHandler("test_typed.csv", LockType::Mutex);
+  csvHandler.clear();
+  csvHandler.setFlushPolicy(FlushPolicy::EveryNBytes, 1 << 16);
+  const std::string name = "Task_name_longer_than_sso";
+  for (int i = 0; i < 100; ++i) {
+    csvHandler.writeRow(i, name, i % 2 == 0); // warm-up
+  }
+  AllocationCounter::setEnabled(true);
+  AllocationCounter::reset();
+  for (int i = 100; i < 1000; ++i) {
+    csvHandler.writeRow(i, name, i % 2 == 0);
+  }
+  AllocationCounter::setEnabled(false);
+  // only the row index grows now and then, nothing is allocated per row
+  assert(AllocationCounter::getCount() < 10);
+  csvHandler.flush();
+
+  auto rows = csvHandler.readAll();
+  assert(rows.size() == 1000);
+  assert(rows[999] ==
+         std::vector<std::string>({"999", name, "Incomplete"}));
+  std::cout << "[Test-Typed] Typed rows written without allocating."
+            << std::endl;
+}
+
+// Snapshot isolation: readers never take the lock, see only committed rows
+// and always a prefix of the file, while a writer keeps appending
+void testSnapshotReads() {
+  printSeparator("Test CSVHandler snapshot reads");
+
+  for (ReadMode mode : {ReadMode::Stream, ReadMode::Mmap}) {
+    CSVHandler csvHandler("test_snapshot_reads.csv", LockType::RWLock);
+    csvHandler.clear();
+    csvHandler.setReadMode(mode);
+    csvHandler.setReadIsolation(ReadIsolation::Snapshot);
+    csvHandler.setFlushPolicy(FlushPolicy::EveryNRows, 7);
+
+    const int rowCount = 20000;
+    std::thread writer([&csvHandler, rowCount] {
+      for (int i = 0; i < rowCount; ++i) {
+        csvHandler.writeRow(i, "Task_" + std::to_string(i), true);
+      }
+      csvHandler.flush();
+    });
+    size_t lastRows = 0;
+    while (lastRows < static_cast<size_t>(rowCount)) {
+      CSVTable table = csvHandler.readTable();
+      assert(table.rowCount() >= lastRows);
+      assert(table.rowCount() % 7 == 0 ||
+             table.rowCount() == static_cast<size_t>(rowCount));
+      for (size_t i = lastRows; i < table.rowCount(); ++i) {
+        assert(table.row(i)[0] == std::to_string(i));
+      }
+      lastRows = table.rowCount();
+    }
+    writer.join();
+
+    // a writer holding the lock does not stop a snapshot reader
+    csvHandler.getRWLock()->writeLock();
+    assert(csvHandler.readAll().size() == static_cast<size_t>(rowCount));
+    assert(csvHandler.rowCount() == rowCount);
+    assert(csvHandler.readRow(rowCount - 1)[0] ==
+           std::to_string(rowCount - 1));
+    CSVCursor cursor;
+    assert(csvHandler.readSince(cursor).size() ==
+           static_cast<size_t>(rowCount));
+    assert(csvHandler.getSnapshot()->rowCount() ==
+           static_cast<size_t>(rowCount));
+    csvHandler.getRWLock()->writeUnlock();
+
+    // bytes past the committed offset, here appended behind the handler's
+    // back, stay invisible to the streaming readers as well
+    {
+      std::ofstream external("test_snapshot_reads.csv", std::ios::app);
+      external << "-1,Uncommitted,Complete\n";
+    }
+    assert(csvHandler.forEachRow([](const CSVRow &) { return true; }) ==
+           rowCount);
+    CSVRowReader reader = csvHandler.openRowReader();
+    long readerRows = 0;
+    for (const CSVRow &row : reader) {
+      assert(row[0] != "-1");
+      readerRows++;
+    }
+    assert(readerRows == rowCount);
+    assert(csvHandler.getSnapshot()->rowCount() ==
+           static_cast<size_t>(rowCount));
+
+    csvHandler.clear();
+    assert(csvHandler.getCommittedBytes() == 0);
+    assert(csvHandler.readAll().empty());
+  }
+  std::cout << "[Test-SnapshotReads] Lock-free committed reads verified."
+            << std::endl;
+}
+
+// readAll into a memory resource: same rows, and the rows themselves come
+// from the resource rather than operator new
+void testPmrReadAll() {
+  printSeparator("Test CSVHandler pmr readAll");
+
+  CSVHandler csvHandler("test_pmr_read.csv", LockType::Mutex);
+  csvHandler.clear();
+  for (int i = 0; i < 1000; ++i) {
+    csvHandler.writeRow(i, "Task_name_longer_than_sso", i % 3 == 0);
+  }
+  csvHandler.flush();
+  auto expected = csvHandler.readAll();
+
+  // a stack buffer with no upstream: a stray global allocation would throw
+  std::vector<char> buffer(1 << 20);
+  std::pmr::monotonic_buffer_resource arena(
+      buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+  AllocationCounter::setEnabled(true);
+  AllocationCounter::reset();
+  auto rows = csvHandler.readAll(&arena);
+  long allocations = AllocationCounter::getCount();
+  AllocationCounter::setEnabled(false);
+
+  assert(rows.size() == expected.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    assert(rows[i].size() == expected[i].size());
+    for (size_t j = 0; j < rows[i].size(); ++j) {
+      assert(std::string_view(rows[i][j]) == expected[i][j]);
+    }
+  }
+  assert(rows.get_allocator().resource() == &arena);
+  assert(rows[0][1].get_allocator().resource() == &arena);
+  // only the table read underneath allocates, not one block per row
+  assert(allocations < 100);
+  std::cout << "[Test-Pmr] " << rows.size() << " rows read into the arena, "
+            << allocations << " global allocations." << std::endl;
+}
+
 // Comprehensive test for CSVHandler with edge cases
 void testCSVHandler() {
   const std::string testFilePath = "test_shared.csv";
@@ -95,8 +917,50 @@ void testCSVHandler() {
   // Test with RWLock (reader-writer lock)
   testCSVHandlerWithLockTypeOnSameFile(LockType::RWLock, "RWLock");
 
-  // Test with NoLock (no locking mechanism)
-  testCSVHandlerWithLockTypeOnSameFile(LockType::NoLock, "NoLock");
+  // Test buffered write policies
+  testFlushPolicies();
+
+  // Test group commit durability levels
+  testGroupCommit(Durability::Flush, "Flush");
+  testGroupCommit(Durability::FDataSync, "FDataSync");
+  testGroupCommitFailures();
+
+  // Test lock-free O_APPEND writes
+  testAtomicAppend();
+
+  // Test incremental tail reads
+  testReadSince();
+
+  // Test the mmap read path
+  testMmapRead();
+
+  // Test zero-copy row views
+  testReadTable();
+
+  // Test RFC 4180 quoted fields
+  testQuotedFields();
+
+  // Test chunked parallel parsing
+  testParallelRead();
+
+  // Test streaming row reads
+  testForEachRow();
+
+  // Test projection and predicate pushdown
+  testQuery();
+
+  // Test the row offset index
+  testRowIndex();
+
+  // Test the shared snapshot cache
+  testSnapshot();
+
+  // Test the io_uring backend
+  testIOUringBackend();
+  testDirectIOBackend();
+  testTypedWriteRow();
+  testSnapshotReads();
+  testPmrReadAll();
 }
 
 int main() {
@@ -114,4 +978,5 @@ int main() {
 //     ../CSVHandler.cpp \
 //     ../util/MutexLock.cpp \
 //     ../util/RWLock.cpp \
+//     ../util/AllocationCounter.cpp \
 //     testCSV.cpp
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "../CSVHandler.h"
+#include "../ShardedCSVWriter.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Print separator for better test output
+void printSeparator(const std::string &testName) {
+  std::cout << "\n===== " << testName << " =====\n" << std::endl;
+}
+
+// every writer thread gets its own shard, readers merge them
+void testShardPerThread() {
+  printSeparator("Test ShardedCSVWriter shard per thread");
+  ShardedCSVWriter writer("test_sharded.csv", 256);
+
+  // thread t writes ids t, t + 4, t + 8, ...: interleaved across shards
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&writer, t] {
+      for (int id = t; id < 4000; id += 4) {
+        writer.writeRow({std::to_string(id), "Task_" + std::to_string(id),
+                         "Complete"});
+      }
+    });
+  }
+  for (auto &thread : writers) {
+    thread.join();
+  }
+  assert(writer.getShardCount() == 4);
+  // the last rows are still buffered, counted but not in the files yet
+  assert(writer.rowCount() == 4000);
+  assert(writer.writtenRowCount() < 4000);
+  writer.flush();
+  assert(writer.writtenRowCount() == 4000);
+
+  auto merged = writer.readAll(MergeOrder::ById);
+  assert(merged.size() == 4000);
+  for (int id = 0; id < 4000; ++id) {
+    assert(merged[id][0] == std::to_string(id));
+    assert(merged[id][1] == "Task_" + std::to_string(id));
+  }
+
+  // concatenation keeps each shard in write order
+  auto concatenated = writer.readAll(MergeOrder::Concatenate);
+  assert(concatenated.size() == 4000);
+  int step = std::stoi(concatenated[1][0]) - std::stoi(concatenated[0][0]);
+  assert(step == 4);
+
+  // early stop
+  long visited = writer.forEachRow(MergeOrder::ById,
+                                   [](const CSVRow &row) {
+                                     return row[0] != "9";
+                                   });
+  assert(visited == 10);
+  std::cout << "Shard per thread test passed." << std::endl;
+}
+
+// compaction writes the merged rows into one CSV, shards can be removed
+void testCompaction() {
+  printSeparator("Test ShardedCSVWriter compaction");
+  CSVHandler target("test_sharded_compact.csv");
+  {
+    ShardedCSVWriter writer("test_sharded_compact.csv");
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 3; ++t) {
+      writers.emplace_back([&writer, t] {
+        // out of order within a shard, the merge sorts it
+        for (int i = 99; i >= 0; --i) {
+          int id = i * 3 + t;
+          writer.writeRow(
+              {std::to_string(id), "Task, \"" + std::to_string(id) + "\"",
+               "Complete"});
+        }
+      });
+    }
+    for (auto &thread : writers) {
+      thread.join();
+    }
+    assert(writer.compact(target) == 300);
+    writer.removeShards();
+    assert(writer.getShardCount() == 0);
+
+    // the writer is usable again after removeShards
+    writer.writeRow({"300", "Task", "Complete"});
+    writer.flush();
+    assert(writer.rowCount() == 1);
+    writer.removeShards();
+  }
+
+  assert(target.rowCount() == 300);
+  auto rows = target.readAll();
+  for (int id = 0; id < 300; ++id) {
+    assert(rows[id][0] == std::to_string(id));
+    assert(rows[id][1] == "Task, \"" + std::to_string(id) + "\"");
+  }
+  std::cout << "Compaction test passed." << std::endl;
+}
+
+int main() {
+  testShardPerThread();
+  testCompaction();
+  std::cout << "\nAll ShardedCSVWriter tests passed." << std::endl;
+  return 0;
+}
@@ -1,6 +1,9 @@
 #include "../TaskQueue.h"
 #include <cassert>
 #include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -324,6 +327,53 @@ void multiThreadTest() {
   std::cout << "Multi Thread Test Passed.\n";
 }
 
+// memory resource counting the blocks of one size it hands out
+class SizeCountingResource : public std::pmr::memory_resource {
+public:
+  explicit SizeCountingResource(size_t size) : size(size) {}
+  int count = 0;
+
+private:
+  size_t size;
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    if (bytes == size) {
+      count++;
+    }
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+// Task names too long for the small-string buffer are stored in the
+// queue's resource, whether the task is copied or moved in
+void pmrTaskNameTest() {
+  std::cout << "Running Pmr Task Name Test...\n";
+  const std::string name(40, 'x'); // heap-backed, 41-byte blocks
+  SizeCountingResource resource(name.size() + 1);
+  {
+    TaskQueue taskQueue(LockType::Mutex, nullptr, &resource);
+    for (int i = 0; i < 5; ++i) {
+      Task task{i, name, false};
+      taskQueue.enqueue(task);
+      taskQueue.enqueue(Task{i, name, false});
+    }
+    assert(resource.count == 10);
+
+    Task task;
+    for (int i = 0; i < 10; ++i) {
+      assert(taskQueue.dequeue(task));
+      assert(std::string_view(task.name) == name);
+    }
+  }
+  assert(resource.count == 10); // dequeued names leave the resource
+  std::cout << "Pmr Task Name Test Passed.\n";
+}
+
 int main() {
   try {
     // testTaskQueueBasic();
@@ -337,6 +387,7 @@ int main() {
     // testTaskQueueEmptyDequeueWithProducer();
     singleThreadTest();
     multiThreadTest();
+    pmrTaskNameTest();
 
     cout << "\nAll TaskQueue tests passed successfully!" << endl;
   } catch (const exception &e) {
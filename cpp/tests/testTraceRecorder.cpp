@@ -0,0 +1,138 @@
+#include "../TaskQueue.h"
+#include "../util/ThreadManager.h"
+#include "../util/TraceRecorder.h"
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+TaskQueue *sharedQueue = nullptr;
+
+void *producer(void *) {
+  for (int i = 1; i <= 5; ++i) {
+    sharedQueue->enqueue(Task{i, "Task_" + to_string(i), false});
+  }
+  return nullptr;
+}
+
+void *consumer(void *) {
+  Task t;
+  for (int i = 0; i < 5; ++i) {
+    sharedQueue->dequeue(t);
+  }
+  return nullptr;
+}
+
+string readFile(const string &path) {
+  ifstream file(path);
+  stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+size_t countOf(const string &text, const string &pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+// Test trace export: one named track per ThreadManager thread
+void testTraceExport() {
+  cout << "===== Test TraceRecorder Chrome Trace Export =====" << endl;
+  TraceRecorder::setEnabled(true);
+
+  TaskQueue queue(LockType::Mutex, nullptr);
+  sharedQueue = &queue;
+
+  ThreadManager threadManager;
+  threadManager.createThread(consumer, nullptr, nullptr, "Consumer");
+  threadManager.createThread(producer, nullptr, nullptr, "Producer");
+  threadManager.joinAllThreads();
+
+  const string tracePath = "test_trace.json";
+  assert(TraceRecorder::exportChromeTrace(tracePath));
+  string trace = readFile(tracePath);
+
+  assert(trace.find("\"traceEvents\"") != string::npos);
+  assert(trace.find("\"name\":\"Consumer-1\"") != string::npos);
+  assert(trace.find("\"name\":\"Producer-2\"") != string::npos);
+  // begin and end events are balanced
+  // one span per enqueue, and one lock-hold span inside it
+  assert(countOf(trace, "\"TaskQueue::enqueue\",\"ph\":\"B\"") == 5);
+  assert(countOf(trace, "\"held: TaskQueue::enqueue\",\"ph\":\"B\"") == 5);
+  assert(countOf(trace, "\"ph\":\"B\"") == countOf(trace, "\"ph\":\"E\""));
+
+  // buffers are cleared after export
+  assert(TraceRecorder::exportChromeTrace(tracePath));
+  trace = readFile(tracePath);
+  assert(trace.find("TaskQueue::enqueue") == string::npos);
+
+  TraceRecorder::setEnabled(false);
+  cout << "Trace export passed!" << endl;
+}
+
+atomic<bool> stopRecording{false};
+
+void *recorder(void *) {
+  while (!stopRecording.load()) {
+    TraceRecorder::instant("say \"hi\"", "test");
+  }
+  return nullptr;
+}
+
+void *unnamedRecorder(void *) {
+  TraceRecorder::instant("unnamed", "test");
+  return nullptr;
+}
+
+// Test exports while a thread records, JSON escaping, and that a reused
+// pthread_t does not inherit the name of an exited thread
+void testLiveExportAndNames() {
+  cout << "===== Test TraceRecorder Live Export And Names =====" << endl;
+  TraceRecorder::setEnabled(true);
+  const string tracePath = "test_trace_live.json";
+
+  ThreadManager threadManager;
+  threadManager.createThread(recorder, nullptr, nullptr, "Quote\"Back\\slash");
+  for (int i = 0; i < 20; ++i) {
+    assert(TraceRecorder::exportChromeTrace(tracePath));
+  }
+  stopRecording = true;
+  threadManager.joinAllThreads();
+
+  assert(TraceRecorder::exportChromeTrace(tracePath));
+  string trace = readFile(tracePath);
+  assert(trace.find("\"name\":\"Quote\\\"Back\\\\slash-1\"") != string::npos);
+  assert(trace.find("\"name\":\"say \\\"hi\\\"\"") != string::npos);
+
+  // the next thread usually gets the joined thread's id
+  pthread_t unnamed;
+  pthread_create(&unnamed, nullptr, unnamedRecorder, nullptr);
+  pthread_join(unnamed, nullptr);
+  assert(TraceRecorder::exportChromeTrace(tracePath));
+  trace = readFile(tracePath);
+  assert(trace.find("\"unnamed\"") != string::npos);
+  assert(trace.find("Quote") == string::npos);
+
+  TraceRecorder::setEnabled(false);
+  cout << "Live export and names passed!" << endl;
+}
+
+int main() {
+  testTraceExport();
+  testLiveExportAndNames();
+  cout << "All TraceRecorder tests passed!" << endl;
+  return 0;
+}
+
+// g++ -std=c++17 -pthread -o testTraceRecorder testTraceRecorder.cpp \
+//     ../TaskQueue.cpp ../util/MutexLock.cpp ../util/RWlock.cpp \
+//     ../util/LockProfiler.cpp ../util/TraceRecorder.cpp \
+//     ../util/ThreadManager.cpp
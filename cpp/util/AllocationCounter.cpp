@@ -0,0 +1,128 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace {
+// constant-initialized, usable by allocations during static initialization
+atomic<bool> counting{false}; // off: new and delete only add one load
+atomic<long> allocationCount{0};
+atomic<long> allocationBytes{0};
+atomic<long> liveBytes{0};
+atomic<long> peakBytes{0};
+
+// what the block really occupies, the size delete would not tell us
+long usableSize(void *memory) {
+#if defined(__APPLE__)
+  return malloc_size(memory);
+#else
+  return malloc_usable_size(memory);
+#endif
+}
+
+// record one block from malloc or aligned_alloc
+void track(size_t size, void *memory) {
+  allocationCount.fetch_add(1, memory_order_relaxed);
+  allocationBytes.fetch_add(size, memory_order_relaxed);
+  long held = usableSize(memory);
+  long live = liveBytes.fetch_add(held, memory_order_relaxed) + held;
+  long peak = peakBytes.load(memory_order_relaxed);
+  while (live > peak && !peakBytes.compare_exchange_weak(
+                            peak, live, memory_order_relaxed)) {
+  }
+}
+
+void release(void *memory) {
+  if (memory != nullptr && counting.load(memory_order_relaxed)) {
+    liveBytes.fetch_sub(usableSize(memory), memory_order_relaxed);
+  }
+  free(memory);
+}
+} // namespace
+
+// the array and nothrow forms forward to these; the aligned ones are
+// separate, and std::pmr's new_delete_resource uses them. Sized deletes
+// are defined too so a -fsized-deallocation build cannot bypass release.
+void *operator new(size_t size) {
+  while (true) {
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory != nullptr) {
+      if (counting.load(memory_order_relaxed)) {
+        track(size, memory);
+      }
+      return memory;
+    }
+    new_handler handler = get_new_handler();
+    if (handler == nullptr) {
+      throw bad_alloc();
+    }
+    handler();
+  }
+}
+
+void *operator new(size_t size, align_val_t alignment) {
+  size_t align = static_cast<size_t>(alignment);
+  if (align < sizeof(void *)) {
+    align = sizeof(void *);
+  }
+  // aligned_alloc wants a multiple of the alignment
+  size_t rounded = (size + align - 1) & ~(align - 1);
+  while (true) {
+    void *memory = aligned_alloc(align, rounded == 0 ? align : rounded);
+    if (memory != nullptr) {
+      if (counting.load(memory_order_relaxed)) {
+        track(size, memory);
+      }
+      return memory;
+    }
+    new_handler handler = get_new_handler();
+    if (handler == nullptr) {
+      throw bad_alloc();
+    }
+    handler();
+  }
+}
+
+void operator delete(void *memory) noexcept { release(memory); }
+
+void operator delete(void *memory, size_t) noexcept { release(memory); }
+
+void operator delete(void *memory, align_val_t) noexcept { release(memory); }
+
+void operator delete(void *memory, size_t, align_val_t) noexcept {
+  release(memory);
+}
+
+void AllocationCounter::setEnabled(bool on) {
+  counting.store(on, memory_order_relaxed);
+}
+
+long AllocationCounter::getCount() {
+  return allocationCount.load(memory_order_relaxed);
+}
+
+long AllocationCounter::getBytes() {
+  return allocationBytes.load(memory_order_relaxed);
+}
+
+long AllocationCounter::getLiveBytes() {
+  return liveBytes.load(memory_order_relaxed);
+}
+
+long AllocationCounter::getPeakBytes() {
+  return peakBytes.load(memory_order_relaxed);
+}
+
+void AllocationCounter::reset() {
+  allocationCount = 0;
+  allocationBytes = 0;
+  peakBytes = liveBytes.load();
+}
@@ -0,0 +1,24 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+// Process-wide count of global operator new calls, for benchmarks that
+// check a path does not allocate. Linking AllocationCounter.cpp replaces
+// the global operator new/delete with malloc/free; while counting is
+// enabled each call also does a few relaxed atomic updates, otherwise it
+// costs one relaxed load. Only allocations and frees made while enabled
+// are counted, on any thread, so enable it around the measured work only.
+// It is not part of cpp_lib, only RunBenchmark (and tests that count)
+// build it in.
+class AllocationCounter {
+public:
+  static void setEnabled(bool on); // off by default
+  static long getCount(); // operator new calls since the last reset
+  static long getBytes(); // bytes requested by them
+  // heap bytes held through operator new right now (malloc's usable size)
+  // and the most held at once since the last reset
+  static long getLiveBytes();
+  static long getPeakBytes();
+  static void reset(); // the peak restarts at the live bytes
+};
+
+#endif // ALLOCATIONCOUNTER_H
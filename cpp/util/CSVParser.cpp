@@ -0,0 +1,475 @@
+#include "CSVParser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CSV_PARSER_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+const size_t kBlockSize = 64;
+
+// one bit per byte of a 64-byte block
+struct BlockMasks {
+  uint64_t quotes;
+  uint64_t commas;
+  uint64_t newlines;
+};
+
+struct ScalarKernel {
+  static BlockMasks classify(const char *block) {
+    BlockMasks masks = {0, 0, 0};
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      uint64_t bit = uint64_t(1) << i;
+      switch (block[i]) {
+      case '"':
+        masks.quotes |= bit;
+        break;
+      case ',':
+        masks.commas |= bit;
+        break;
+      case '\n':
+        masks.newlines |= bit;
+        break;
+      default:
+        break;
+      }
+    }
+    return masks;
+  }
+};
+
+#if CSV_PARSER_X86
+struct SSE2Kernel {
+  static uint64_t match(const __m128i chunks[4], char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+      uint64_t bits = static_cast<uint32_t>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)));
+      mask |= bits << (16 * i);
+    }
+    return mask;
+  }
+
+  static BlockMasks classify(const char *block) {
+    __m128i chunks[4];
+    for (int i = 0; i < 4; ++i) {
+      chunks[i] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(block + 16 * i));
+    }
+    return {match(chunks, '"'), match(chunks, ','), match(chunks, '\n')};
+  }
+};
+
+struct AVX2Kernel {
+  __attribute__((target("avx2"))) static uint64_t match(__m256i low,
+                                                        __m256i high, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    uint64_t lowBits = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle)));
+    uint64_t highBits = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle)));
+    return lowBits | (highBits << 32);
+  }
+
+  __attribute__((target("avx2"))) static BlockMasks
+  classify(const char *block) {
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    __m256i high =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+    return {match(low, high, '"'), match(low, high, ','),
+            match(low, high, '\n')};
+  }
+};
+#endif
+
+// bit i is set when an odd number of quotes are at or before byte i
+uint64_t prefixXor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+// turns delimiter positions into cells and rows; Filtered applies a query
+template <bool Filtered> class CellBuilder {
+private:
+  const char *data;
+  ParsedRows &rows;
+  const CSVQuery *query;
+  size_t cellStart = 0;
+  size_t rowCellStart;      // first cell of the open row
+  size_t rowUnescapedStart; // first unescaped copy of the open row
+  size_t column = 0;        // column of the next cell
+  uint64_t satisfied = 0;   // predicate columns that matched
+  bool rejected = false;    // a predicate failed, skip to the row end
+
+  // cell text without quotes, "" escapes resolved into rows.unescaped
+  string_view cellValue(size_t begin, size_t end) {
+    if (end == begin || data[begin] != '"') {
+      return string_view(data + begin, end - begin);
+    }
+    begin++;
+    if (end > begin && data[end - 1] == '"') {
+      end--;
+    }
+    const char *quote =
+        static_cast<const char *>(memchr(data + begin, '"', end - begin));
+    if (quote == nullptr) {
+      return string_view(data + begin, end - begin);
+    }
+    // "" escapes: the views cannot skip bytes, keep an unescaped copy
+    string cell(data + begin, quote);
+    for (const char *p = quote; p < data + end; ++p) {
+      cell += *p;
+      if (*p == '"' && p + 1 < data + end && p[1] == '"') {
+        ++p;
+      }
+    }
+    rows.unescaped.push_back(move(cell));
+    return rows.unescaped.back();
+  }
+
+  void dropRowCells() {
+    rows.cells.resize(rowCellStart);
+    rows.unescaped.resize(rowUnescapedStart);
+  }
+
+public:
+  size_t rowEnd = 0; // bytes up to the end of the last finished row
+
+  CellBuilder(const char *data, ParsedRows &rows, const CSVQuery *query)
+      : data(data), rows(rows), query(query), rowCellStart(rows.cells.size()),
+        rowUnescapedStart(rows.unescaped.size()) {}
+
+  void discardOpenRow() { dropRowCells(); }
+
+  bool rowHasContent(size_t end) const {
+    return cellStart < end || column > 0;
+  }
+
+  bool isRejected() const { return Filtered && rejected; }
+
+  void addCell(size_t end, bool endsRow) {
+    size_t begin = cellStart;
+    cellStart = end + 1;
+    if (endsRow && end > begin && data[end - 1] == '\r') {
+      end--; // CRLF line ending
+    }
+    size_t cellColumn = column++;
+
+    // a trailing unquoted empty cell is dropped like getline does
+    bool present = !(endsRow && end == begin);
+    if constexpr (!Filtered) {
+      if (present) {
+        rows.cells.push_back(cellValue(begin, end));
+      }
+    } else if (present && !rejected && query->needs(cellColumn)) {
+      size_t unescapedBefore = rows.unescaped.size();
+      string_view value = cellValue(begin, end);
+      if (query->hasPredicate(cellColumn)) {
+        if (query->accepts(cellColumn, value)) {
+          satisfied |= uint64_t(1) << cellColumn;
+        } else {
+          rejected = true; // the rest of the row is not materialized
+          dropRowCells();
+        }
+      }
+      if (!rejected && query->isSelected(cellColumn)) {
+        rows.cells.push_back(value);
+      } else {
+        rows.unescaped.resize(min(rows.unescaped.size(), unescapedBefore));
+      }
+    }
+
+    if (endsRow) {
+      bool matched = true;
+      if constexpr (Filtered) {
+        uint64_t required = query->getPredicateColumns();
+        matched = !rejected && (satisfied & required) == required;
+        satisfied = 0;
+        rejected = false;
+      }
+      if (matched) {
+        rows.rowStarts.push_back(rowCellStart);
+      } else {
+        dropRowCells();
+      }
+      rowCellStart = rows.cells.size();
+      rowUnescapedStart = rows.unescaped.size();
+      column = 0;
+      rowEnd = cellStart;
+    }
+  }
+};
+
+// always inlined so the AVX2 entry point compiles the whole loop for AVX2
+template <typename Kernel, bool Filtered>
+__attribute__((always_inline)) inline size_t
+parseWith(const char *data, size_t size, ParsedRows &rows,
+          bool completeRowsOnly, const CSVQuery *query) {
+  if (!rows.rowStarts.empty()) {
+    rows.rowStarts.pop_back(); // reopen the closing entry of the last call
+  }
+  CellBuilder<Filtered> builder(data, rows, query);
+  uint64_t insideCarry = 0; // all ones while a quoted field spans blocks
+
+  char tail[kBlockSize];
+  for (size_t base = 0; base < size; base += kBlockSize) {
+    const char *block = data + base;
+    if (size - base < kBlockSize) {
+      // zero padding classifies as nothing
+      memset(tail, 0, kBlockSize);
+      memcpy(tail, block, size - base);
+      block = tail;
+    }
+
+    BlockMasks masks = Kernel::classify(block);
+    uint64_t inside = prefixXor(masks.quotes) ^ insideCarry;
+    insideCarry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+
+    uint64_t commas = masks.commas & ~inside;
+    uint64_t newlines = masks.newlines & ~inside;
+    // a rejected row only needs its end found
+    uint64_t delimiters = builder.isRejected() ? newlines : commas | newlines;
+    while (delimiters != 0) {
+      int bit = __builtin_ctzll(delimiters);
+      bool endsRow = (newlines >> bit) & 1;
+      builder.addCell(base + bit, endsRow);
+      delimiters &= delimiters - 1;
+      if (Filtered && builder.isRejected()) {
+        delimiters &= newlines;
+      } else if (Filtered && endsRow) {
+        delimiters |= commas & ~((uint64_t(2) << bit) - 1);
+      }
+    }
+  }
+
+  size_t consumed = builder.rowEnd;
+  if (!completeRowsOnly && builder.rowHasContent(size)) {
+    builder.addCell(size, true); // unterminated last row
+    consumed = size;
+  }
+  builder.discardOpenRow(); // cells of a partial row left behind
+  rows.rowStarts.push_back(rows.cells.size());
+  return consumed;
+}
+
+template <typename Kernel>
+__attribute__((always_inline)) inline size_t
+parseKernel(const char *data, size_t size, ParsedRows &rows,
+            bool completeRowsOnly, const CSVQuery *query) {
+  return query == nullptr
+             ? parseWith<Kernel, false>(data, size, rows, completeRowsOnly,
+                                        nullptr)
+             : parseWith<Kernel, true>(data, size, rows, completeRowsOnly,
+                                       query);
+}
+
+#if CSV_PARSER_X86
+__attribute__((target("avx2"))) size_t
+parseAVX2(const char *data, size_t size, ParsedRows &rows,
+          bool completeRowsOnly, const CSVQuery *query) {
+  return parseKernel<AVX2Kernel>(data, size, rows, completeRowsOnly, query);
+}
+#endif
+
+// below this many bytes per chunk a thread costs more than it saves
+const size_t kMinChunkSize = 1 << 16;
+
+size_t countQuotes(const char *begin, const char *end) {
+  size_t count = 0;
+  while ((begin = static_cast<const char *>(
+              memchr(begin, '"', end - begin))) != nullptr) {
+    count++;
+    begin++;
+  }
+  return count;
+}
+
+// first row start at or after position, given whether position is inside
+// a quoted field
+size_t nextRowStart(const char *data, size_t size, size_t position,
+                    bool inside) {
+  for (; position < size; ++position) {
+    if (data[position] == '"') {
+      inside = !inside;
+    } else if (data[position] == '\n' && !inside) {
+      return position + 1;
+    }
+  }
+  return size;
+}
+
+// move the cells of part behind those already in rows, fixing row starts
+// and the views of unescaped cells
+void appendParsed(ParsedRows &rows, ParsedRows &part, const char *data,
+                  size_t size) {
+  size_t cellBase = rows.cells.size();
+  for (size_t r = 0; r + 1 < part.rowStarts.size(); ++r) {
+    rows.rowStarts.push_back(cellBase + part.rowStarts[r]);
+  }
+  auto unescaped = part.unescaped.begin();
+  for (string_view cell : part.cells) {
+    if (cell.data() < data || cell.data() > data + size) {
+      // the strings move, so point the cell at the moved copy
+      rows.unescaped.push_back(move(*unescaped++));
+      cell = rows.unescaped.back();
+    }
+    rows.cells.push_back(cell);
+  }
+}
+
+atomic<CSVParser::Kernel> forcedKernel{CSVParser::Kernel::Auto};
+
+CSVParser::Kernel bestKernel() {
+  static const CSVParser::Kernel best =
+      CSVParser::isSupported(CSVParser::Kernel::AVX2)
+          ? CSVParser::Kernel::AVX2
+          : CSVParser::isSupported(CSVParser::Kernel::SSE2)
+                ? CSVParser::Kernel::SSE2
+                : CSVParser::Kernel::Scalar;
+  return best;
+}
+} // namespace
+
+size_t CSVParser::parse(const char *data, size_t size, ParsedRows &rows,
+                        bool completeRowsOnly, const CSVQuery *query) {
+  switch (getKernel()) {
+#if CSV_PARSER_X86
+  case Kernel::AVX2:
+    return parseAVX2(data, size, rows, completeRowsOnly, query);
+  case Kernel::SSE2:
+    return parseKernel<SSE2Kernel>(data, size, rows, completeRowsOnly, query);
+#endif
+  default:
+    return parseKernel<ScalarKernel>(data, size, rows, completeRowsOnly,
+                                     query);
+  }
+}
+
+size_t CSVParser::parseParallel(const char *data, size_t size,
+                                ParsedRows &rows, int threadCount,
+                                bool completeRowsOnly, const CSVQuery *query) {
+  size_t chunkCount = min<size_t>(max(threadCount, 1), size / kMinChunkSize);
+  if (chunkCount <= 1) {
+    return parse(data, size, rows, completeRowsOnly, query);
+  }
+
+  // pass 1: quotes per raw chunk, their running parity is the quote state
+  // at every raw boundary
+  vector<size_t> rawStarts(chunkCount + 1);
+  for (size_t i = 0; i <= chunkCount; ++i) {
+    rawStarts[i] = size / chunkCount * i;
+  }
+  rawStarts[chunkCount] = size;
+  vector<size_t> quoteCounts(chunkCount);
+  vector<thread> workers;
+  for (size_t i = 0; i < chunkCount; ++i) {
+    workers.emplace_back([&, i]() {
+      quoteCounts[i] =
+          countQuotes(data + rawStarts[i], data + rawStarts[i + 1]);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+
+  // resync every boundary to the next row start
+  vector<size_t> chunkStarts(chunkCount + 1);
+  size_t quotesBefore = 0;
+  chunkStarts[0] = 0;
+  for (size_t i = 1; i < chunkCount; ++i) {
+    quotesBefore += quoteCounts[i - 1];
+    bool inside = quotesBefore % 2 == 1;
+    size_t start = !inside && data[rawStarts[i] - 1] == '\n'
+                       ? rawStarts[i]
+                       : nextRowStart(data, size, rawStarts[i], inside);
+    chunkStarts[i] = max(chunkStarts[i - 1], start);
+  }
+  chunkStarts[chunkCount] = size;
+
+  // pass 2: parse the chunks, only the last one can end mid-row
+  vector<ParsedRows> parts(chunkCount);
+  vector<size_t> consumed(chunkCount);
+  for (size_t i = 0; i < chunkCount; ++i) {
+    workers.emplace_back([&, i]() {
+      consumed[i] = parse(data + chunkStarts[i],
+                          chunkStarts[i + 1] - chunkStarts[i], parts[i],
+                          i + 1 == chunkCount && completeRowsOnly, query);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // stitch in order
+  if (!rows.rowStarts.empty()) {
+    rows.rowStarts.pop_back();
+  }
+  size_t cellCount = rows.cells.size();
+  for (const auto &part : parts) {
+    cellCount += part.cells.size();
+  }
+  rows.cells.reserve(cellCount);
+  for (auto &part : parts) {
+    appendParsed(rows, part, data, size);
+  }
+  rows.rowStarts.push_back(rows.cells.size());
+  return chunkStarts[chunkCount - 1] + consumed[chunkCount - 1];
+}
+
+void CSVParser::setKernel(Kernel kernel) {
+  if (!isSupported(kernel)) {
+    throw runtime_error(string("CSV parser kernel not supported: ") +
+                        kernelName(kernel));
+  }
+  forcedKernel = kernel;
+}
+
+CSVParser::Kernel CSVParser::getKernel() {
+  Kernel kernel = forcedKernel.load(memory_order_relaxed);
+  return kernel == Kernel::Auto ? bestKernel() : kernel;
+}
+
+bool CSVParser::isSupported(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Auto:
+  case Kernel::Scalar:
+    return true;
+#if CSV_PARSER_X86
+  case Kernel::SSE2:
+    return __builtin_cpu_supports("sse2");
+  case Kernel::AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *CSVParser::kernelName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Auto:
+    return "Auto";
+  case Kernel::Scalar:
+    return "Scalar";
+  case Kernel::SSE2:
+    return "SSE2";
+  case Kernel::AVX2:
+    return "AVX2";
+  }
+  return "Unknown";
+}
@@ -0,0 +1,56 @@
+#ifndef CSVPARSER_H
+#define CSVPARSER_H
+
+#include "CSVQuery.h"
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Cells of a parsed range, row r covers cells[rowStarts[r], rowStarts[r + 1])
+struct ParsedRows {
+  std::vector<std::string_view> cells; // views into the input, or unescaped
+  std::vector<size_t> rowStarts;       // always ends with a closing entry
+  std::deque<std::string> unescaped;   // cells rewritten from "" escapes
+};
+
+// In-place RFC 4180 CSV tokenizer over a memory range (e.g. a mapped file).
+// The input is classified 64 bytes at a time into quote / comma / newline
+// bitmasks (AVX2, SSE2 or scalar, chosen at runtime); a prefix XOR of the
+// quote mask marks the bytes inside quoted fields, whose commas and
+// newlines are not delimiters. Quoted cells are returned without their
+// quotes, "" inside them becomes ", and rows end at "\n" or "\r\n" (the
+// "\r" is dropped; a bare "\r" does not end a row). A trailing unquoted
+// empty cell is dropped the way getline(stream, cell, ',') does, so plain
+// files split as before.
+class CSVParser {
+public:
+  enum class Kernel { Auto, Scalar, SSE2, AVX2 };
+
+  // append the rows in [data, data + size) to rows. With completeRowsOnly
+  // an unterminated last row (including one cut inside quotes) is left
+  // out. With a query only matching rows and selected cells are kept; a
+  // row is dropped at its first failing predicate and the scan skips to
+  // its end. Returns the number of bytes consumed.
+  static size_t parse(const char *data, size_t size, ParsedRows &rows,
+                      bool completeRowsOnly = false,
+                      const CSVQuery *query = nullptr);
+
+  // same result as parse(), with the range split into up to threadCount
+  // chunks that are parsed concurrently and stitched back in order. Chunk
+  // boundaries move forward to the next newline outside quotes; the quote
+  // state at each boundary comes from a parallel count of the quotes
+  // before it. Small inputs are parsed on the calling thread.
+  static size_t parseParallel(const char *data, size_t size, ParsedRows &rows,
+                              int threadCount, bool completeRowsOnly = false,
+                              const CSVQuery *query = nullptr);
+
+  // force a kernel (benchmarks, tests); Auto picks the best supported one
+  static void setKernel(Kernel kernel);
+  static Kernel getKernel(); // the kernel parse() will use
+  static bool isSupported(Kernel kernel);
+  static const char *kernelName(Kernel kernel);
+};
+
+#endif // CSVPARSER_H
@@ -0,0 +1,59 @@
+#include "CSVQuery.h"
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+void checkColumn(size_t column) {
+  if (column >= CSVQuery::kMaxColumns) {
+    throw invalid_argument("Query column out of range: " + to_string(column));
+  }
+}
+} // namespace
+
+CSVQuery &CSVQuery::select(const vector<size_t> &columns) {
+  selectAll = false;
+  selectedMask = 0;
+  for (size_t column : columns) {
+    checkColumn(column);
+    selectedMask |= uint64_t(1) << column;
+  }
+  return *this;
+}
+
+CSVQuery &CSVQuery::whereEquals(size_t column, string value) {
+  checkColumn(column);
+  predicates.push_back({column, false, move(value), 0, 0});
+  predicateMask |= uint64_t(1) << column;
+  return *this;
+}
+
+CSVQuery &CSVQuery::whereBetween(size_t column, long low, long high) {
+  checkColumn(column);
+  predicates.push_back({column, true, string(), low, high});
+  predicateMask |= uint64_t(1) << column;
+  return *this;
+}
+
+bool CSVQuery::accepts(size_t column, string_view cell) const {
+  for (const auto &predicate : predicates) {
+    if (predicate.column != column) {
+      continue;
+    }
+    if (!predicate.isRange) {
+      if (cell != predicate.value) {
+        return false;
+      }
+      continue;
+    }
+    long number;
+    auto [end, error] = from_chars(cell.data(), cell.data() + cell.size(),
+                                   number);
+    if (error != errc() || end != cell.data() + cell.size() ||
+        number < predicate.low || number > predicate.high) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef CSVQUERY_H
+#define CSVQUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Column projection and row predicates applied while a file is parsed.
+// Columns are 0-based and limited to the first 64. Selected cells come
+// back in file order; a row missing a predicate column does not match.
+//
+//   CSVQuery query;
+//   query.select({0, 2}).whereEquals(2, "Complete").whereBetween(0, 1, 99);
+class CSVQuery {
+public:
+  static const size_t kMaxColumns = 64;
+
+  // keep only these columns (all columns if never called)
+  CSVQuery &select(const std::vector<size_t> &columns);
+  // cell equals value exactly
+  CSVQuery &whereEquals(size_t column, std::string value);
+  // cell is an integer in [low, high]
+  CSVQuery &whereBetween(size_t column, long low, long high);
+
+  bool isSelected(size_t column) const {
+    return column < kMaxColumns ? (selectedMask >> column) & 1 : selectAll;
+  }
+  bool hasPredicate(size_t column) const {
+    return column < kMaxColumns && (predicateMask >> column) & 1;
+  }
+  // the parser needs the cell for the output or for a predicate
+  bool needs(size_t column) const {
+    return isSelected(column) || hasPredicate(column);
+  }
+  uint64_t getPredicateColumns() const { return predicateMask; }
+
+  // all predicates on this column hold for the cell
+  bool accepts(size_t column, std::string_view cell) const;
+
+private:
+  struct Predicate {
+    size_t column;
+    bool isRange;
+    std::string value; // equality operand
+    long low;          // inclusive range bounds
+    long high;
+  };
+
+  bool selectAll = true;
+  uint64_t selectedMask = ~uint64_t(0);
+  uint64_t predicateMask = 0;
+  std::vector<Predicate> predicates;
+};
+
+#endif // CSVQUERY_H
@@ -0,0 +1,90 @@
+#include "CSVRowReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+CSVRowReader::CSVRowReader(const string &path, size_t bufferSize,
+                           bool completeRowsOnly, const CSVQuery *query,
+                           long endOffset)
+    : filePath(path), buffer(max<size_t>(bufferSize, 1)),
+      completeRowsOnly(completeRowsOnly), query(query), endOffset(endOffset) {
+  fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw runtime_error("Cannot open file: " + filePath);
+  }
+  rows.rowStarts.push_back(0); // no rows yet
+}
+
+CSVRowReader::~CSVRowReader() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+bool CSVRowReader::next(CSVRow &row) {
+  while (nextRow + 1 >= rows.rowStarts.size()) {
+    if (!refill()) {
+      return false;
+    }
+  }
+  const vector<size_t> &starts = rows.rowStarts;
+  row = CSVRow(rows.cells.data() + starts[nextRow],
+               starts[nextRow + 1] - starts[nextRow]);
+  nextRow++;
+  return true;
+}
+
+// drop the rows handed out, keep the partial row and read more behind it
+bool CSVRowReader::refill() {
+  if (finished) {
+    return false;
+  }
+
+  memmove(buffer.data(), buffer.data() + parsedEnd, bufferEnd - parsedEnd);
+  bufferEnd -= parsedEnd;
+  parsedEnd = 0;
+  rows.cells.clear();
+  rows.rowStarts.clear();
+  rows.unescaped.clear();
+  nextRow = 0;
+
+  if (endOfFile) {
+    // whatever is left is an unterminated last row
+    finished = true;
+    parsedEnd = CSVParser::parse(buffer.data(), bufferEnd, rows,
+                                 completeRowsOnly, query);
+    return true;
+  }
+
+  if (bufferEnd == buffer.size()) {
+    buffer.resize(buffer.size() * 2); // one row longer than the buffer
+  }
+  size_t wanted = buffer.size() - bufferEnd;
+  if (endOffset >= 0) {
+    wanted = min(wanted, static_cast<size_t>(max(endOffset - readOffset, 0L)));
+  }
+  ssize_t bytesRead = 0;
+  while (wanted > 0) {
+    bytesRead = read(fd, buffer.data() + bufferEnd, wanted);
+    if (bytesRead >= 0 || errno != EINTR) {
+      break;
+    }
+  }
+  if (bytesRead < 0) {
+    throw runtime_error("Error reading file: " + filePath + ": " +
+                        strerror(errno));
+  }
+  if (bytesRead == 0) {
+    endOfFile = true; // or at endOffset
+  }
+  bufferEnd += bytesRead;
+  readOffset += bytesRead;
+
+  parsedEnd = CSVParser::parse(buffer.data(), bufferEnd, rows, true, query);
+  return true;
+}
@@ -0,0 +1,79 @@
+#ifndef CSVROWREADER_H
+#define CSVROWREADER_H
+
+#include "CSVParser.h"
+#include "CSVTable.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Pull-style row reader that streams a file through a fixed-size buffer.
+// Rows are CSVRow views into the buffer and stay valid until the next call
+// to next(); memory does not grow with the file, only a single row longer
+// than the buffer makes it grow (to fit that row).
+class CSVRowReader {
+private:
+  std::string filePath;
+  int fd = -1;
+  std::vector<char> buffer;
+  size_t bufferEnd = 0; // bytes of buffer holding file data
+  size_t parsedEnd = 0; // bytes of buffer covered by rows
+  ParsedRows rows;      // rows of the current buffer, reused
+  size_t nextRow = 0;
+  bool endOfFile = false;
+  bool finished = false;
+  bool completeRowsOnly; // skip an unterminated last row at end of file
+  const CSVQuery *query; // optional filter, must outlive the reader
+  long endOffset;        // stop reading here, -1 reads to end of file
+  long readOffset = 0;   // file offset of the next read
+
+  bool refill();
+
+public:
+  static const size_t kDefaultBufferSize = 1 << 16;
+
+  class Iterator {
+  private:
+    CSVRowReader *reader;
+    CSVRow current;
+
+  public:
+    explicit Iterator(CSVRowReader *reader) : reader(reader) { ++*this; }
+    Iterator() : reader(nullptr) {}
+    const CSVRow &operator*() const { return current; }
+    Iterator &operator++() {
+      if (reader != nullptr && !reader->next(current)) {
+        reader = nullptr;
+      }
+      return *this;
+    }
+    bool operator!=(const Iterator &other) const {
+      return reader != other.reader;
+    }
+    bool operator==(const Iterator &other) const {
+      return reader == other.reader;
+    }
+  };
+
+  // endOffset bounds the read, e.g. at a writer's committed offset, and
+  // the file is treated as ending there
+  explicit CSVRowReader(const std::string &path,
+                        size_t bufferSize = kDefaultBufferSize,
+                        bool completeRowsOnly = false,
+                        const CSVQuery *query = nullptr, long endOffset = -1);
+  ~CSVRowReader();
+
+  CSVRowReader(const CSVRowReader &) = delete;
+  CSVRowReader &operator=(const CSVRowReader &) = delete;
+
+  // next row, false at end of file
+  bool next(CSVRow &row);
+
+  // single-pass iteration: for (const CSVRow &row : reader)
+  Iterator begin() { return Iterator(this); }
+  Iterator end() { return Iterator(); }
+
+  size_t getBufferSize() const { return buffer.size(); }
+};
+
+#endif // CSVROWREADER_H
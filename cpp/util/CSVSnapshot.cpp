@@ -0,0 +1,44 @@
+#include "CSVSnapshot.h"
+#include <algorithm>
+
+using namespace std;
+
+shared_ptr<const CSVSnapshot>
+CSVSnapshot::extend(shared_ptr<const CSVTable> segment,
+                    long newByteSize) const {
+  auto next = make_shared<CSVSnapshot>(*this); // shares the old segments
+  next->segmentEnds.push_back(rowCount() + segment->rowCount());
+  next->segments.push_back(move(segment));
+  next->byteSize = newByteSize;
+
+  auto &segments = next->segments;
+  while (segments.size() >= 2 &&
+         segments.back()->rowCount() >=
+             segments[segments.size() - 2]->rowCount()) {
+    auto merged = make_shared<const CSVTable>(
+        CSVTable::concat(*segments[segments.size() - 2], *segments.back()));
+    segments.pop_back();
+    segments.back() = move(merged);
+    // the merged segment ends where the last one did
+    next->segmentEnds.erase(next->segmentEnds.end() - 2);
+  }
+  return next;
+}
+
+CSVRow CSVSnapshot::row(size_t i) const {
+  // first segment whose cumulative row count passes i
+  size_t segment =
+      upper_bound(segmentEnds.begin(), segmentEnds.end(), i) -
+      segmentEnds.begin();
+  size_t first = segment == 0 ? 0 : segmentEnds[segment - 1];
+  return segments[segment]->row(i - first);
+}
+
+vector<vector<string>> CSVSnapshot::toVectors() const {
+  vector<vector<string>> rows;
+  rows.reserve(rowCount());
+  for (CSVRow row : *this) {
+    rows.push_back(row.toVector());
+  }
+  return rows;
+}
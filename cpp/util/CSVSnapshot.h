@@ -0,0 +1,79 @@
+#ifndef CSVSNAPSHOT_H
+#define CSVSNAPSHOT_H
+
+#include "CSVTable.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Immutable parsed view of a CSV file up to byteSize, tagged with the file
+// generation (bumped by CSVHandler::clear). Appends produce a new snapshot
+// that shares the parsed segments of the old one and adds one segment for
+// the new bytes, so nothing already parsed is parsed again. Segments are
+// merged like a binary counter (CSVTable::concat copies cell views), so n
+// appends leave O(log n) segments and each row is copied O(log n) times.
+class CSVSnapshot {
+private:
+  long generation = 0;
+  long byteSize = 0; // file bytes covered by the segments
+  std::vector<std::shared_ptr<const CSVTable>> segments;
+  std::vector<size_t> segmentEnds; // rows up to and including segment i
+
+public:
+  class Iterator {
+  private:
+    const CSVSnapshot *snapshot;
+    size_t segment;
+    size_t row; // within the segment
+
+    void skipEmpty() {
+      while (segment < snapshot->segments.size() &&
+             row >= snapshot->segments[segment]->rowCount()) {
+        segment++;
+        row = 0;
+      }
+    }
+
+  public:
+    Iterator(const CSVSnapshot *snapshot, size_t segment)
+        : snapshot(snapshot), segment(segment), row(0) {
+      skipEmpty();
+    }
+    CSVRow operator*() const { return snapshot->segments[segment]->row(row); }
+    Iterator &operator++() {
+      ++row;
+      skipEmpty();
+      return *this;
+    }
+    bool operator!=(const Iterator &other) const {
+      return segment != other.segment || row != other.row;
+    }
+    bool operator==(const Iterator &other) const { return !(*this != other); }
+  };
+
+  explicit CSVSnapshot(long generation) : generation(generation) {}
+
+  // this snapshot plus the rows of one more segment, ending at newByteSize;
+  // the newest segments are merged while the last is no smaller than the
+  // one before it
+  std::shared_ptr<const CSVSnapshot>
+  extend(std::shared_ptr<const CSVTable> segment, long newByteSize) const;
+
+  long getGeneration() const { return generation; }
+  long getByteSize() const { return byteSize; }
+  size_t getSegmentCount() const { return segments.size(); }
+
+  size_t rowCount() const {
+    return segmentEnds.empty() ? 0 : segmentEnds.back();
+  }
+  CSVRow row(size_t i) const;
+  CSVRow operator[](size_t i) const { return row(i); }
+  Iterator begin() const { return Iterator(this, 0); }
+  Iterator end() const { return Iterator(this, segments.size()); }
+
+  // owning copy in the shape readAll returns
+  std::vector<std::vector<std::string>> toVectors() const;
+};
+
+#endif // CSVSNAPSHOT_H
@@ -0,0 +1,95 @@
+#include "CSVTable.h"
+#include <algorithm>
+
+using namespace std;
+
+vector<string> CSVRow::toVector() const {
+  return vector<string>(begin(), end());
+}
+
+CSVTable::CSVTable(shared_ptr<const void> owner, string_view contents,
+                   bool completeRowsOnly, int parseThreads,
+                   const CSVQuery *query)
+    : owners{move(owner)}, contents(contents), inputBytes(contents.size()) {
+  parsedBytes =
+      CSVParser::parseParallel(contents.data(), contents.size(), parsed,
+                               parseThreads, completeRowsOnly, query);
+}
+
+CSVTable::CSVTable(string buffer, bool completeRowsOnly, int parseThreads,
+                   const CSVQuery *query) {
+  // the string lives on the heap behind owner, so moving the table keeps
+  // the views valid (a moved small string would not)
+  auto stored = make_shared<const string>(move(buffer));
+  contents = *stored;
+  inputBytes = contents.size();
+  owners.push_back(move(stored));
+  parsedBytes =
+      CSVParser::parseParallel(contents.data(), contents.size(), parsed,
+                               parseThreads, completeRowsOnly, query);
+}
+
+CSVTable CSVTable::concat(const CSVTable &first, const CSVTable &second) {
+  CSVTable table;
+  table.owners = first.owners;
+  table.owners.insert(table.owners.end(), second.owners.begin(),
+                      second.owners.end());
+  table.inputBytes = first.inputBytes + second.inputBytes;
+  table.parsedBytes = first.parsedBytes + second.parsedBytes;
+
+  ParsedRows &rows = table.parsed;
+  rows.cells.reserve(first.parsed.cells.size() + second.parsed.cells.size());
+  rows.rowStarts.reserve(first.rowCount() + second.rowCount() + 1);
+  for (const CSVTable *part : {&first, &second}) {
+    // cells rewritten from "" escapes live in the part's own strings, which
+    // die with it; sorted by address to find them
+    vector<string_view> escaped(part->parsed.unescaped.begin(),
+                                part->parsed.unescaped.end());
+    sort(escaped.begin(), escaped.end(),
+         [](string_view a, string_view b) { return a.data() < b.data(); });
+    auto isEscaped = [&escaped](string_view cell) {
+      auto next = upper_bound(escaped.begin(), escaped.end(), cell.data(),
+                              [](const char *data, string_view text) {
+                                return data < text.data();
+                              });
+      // <=: an empty cell may point at the terminating null
+      return next != escaped.begin() &&
+             cell.data() <= prev(next)->data() + prev(next)->size();
+    };
+    for (CSVRow row : *part) {
+      rows.rowStarts.push_back(rows.cells.size());
+      for (string_view cell : row) {
+        if (!escaped.empty() && isEscaped(cell)) {
+          rows.unescaped.emplace_back(cell); // deque: earlier cells stay put
+          cell = rows.unescaped.back();
+        }
+        rows.cells.push_back(cell);
+      }
+    }
+  }
+  rows.rowStarts.push_back(rows.cells.size()); // closing entry
+  return table;
+}
+
+vector<vector<string>> CSVTable::toVectors() const {
+  vector<vector<string>> rows;
+  rows.reserve(rowCount());
+  for (CSVRow row : *this) {
+    rows.push_back(row.toVector());
+  }
+  return rows;
+}
+
+PmrRows CSVTable::toVectors(pmr::memory_resource *resource) const {
+  PmrRows rows(resource);
+  rows.reserve(rowCount());
+  for (CSVRow row : *this) {
+    // the inner vector and its strings take the resource from rows
+    auto &cells = rows.emplace_back();
+    cells.reserve(row.size());
+    for (string_view cell : row) {
+      cells.emplace_back(cell);
+    }
+  }
+  return rows;
+}
@@ -0,0 +1,111 @@
+#ifndef CSVTABLE_H
+#define CSVTABLE_H
+
+#include "CSVParser.h"
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Owning rows like readAll's, every vector and string allocated from one
+// memory resource
+using PmrRows = std::pmr::vector<std::pmr::vector<std::pmr::string>>;
+
+// View of one parsed row, valid while its CSVTable is alive
+class CSVRow {
+private:
+  const std::string_view *first = nullptr;
+  size_t count = 0;
+
+public:
+  CSVRow() = default;
+  CSVRow(const std::string_view *first, size_t count)
+      : first(first), count(count) {}
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  std::string_view operator[](size_t i) const { return first[i]; }
+  const std::string_view *begin() const { return first; }
+  const std::string_view *end() const { return first + count; }
+
+  std::vector<std::string> toVector() const; // owning copy of the cells
+};
+
+// A parsed CSV file: owns the file bytes (a mapping or a heap buffer) and
+// exposes rows as spans of string_view into them, so iterating needs no
+// per-cell or per-row allocation.
+class CSVTable {
+private:
+  // keep the bytes behind the cells alive, one per table concat() joined
+  std::vector<std::shared_ptr<const void>> owners;
+  std::string_view contents; // empty for a table built by concat()
+  ParsedRows parsed;
+  size_t inputBytes = 0;  // bytes given to the parser, summed by concat()
+  size_t parsedBytes = 0; // prefix of them covered by the rows
+
+public:
+  class Iterator {
+  private:
+    const CSVTable *table;
+    size_t row;
+
+  public:
+    Iterator(const CSVTable *table, size_t row) : table(table), row(row) {}
+    CSVRow operator*() const { return table->row(row); }
+    Iterator &operator++() {
+      ++row;
+      return *this;
+    }
+    bool operator!=(const Iterator &other) const { return row != other.row; }
+    bool operator==(const Iterator &other) const { return row == other.row; }
+  };
+
+  CSVTable() = default;
+  // move-only: unescaped cells point into parsed.unescaped, a copy would
+  // still point into the original
+  CSVTable(CSVTable &&) = default;
+  CSVTable &operator=(CSVTable &&) = default;
+  CSVTable(const CSVTable &) = delete;
+  CSVTable &operator=(const CSVTable &) = delete;
+  // parse bytes kept alive by owner; completeRowsOnly drops a partial last
+  // row, parseThreads > 1 parses large inputs in parallel chunks and a
+  // query keeps only matching rows and selected cells
+  CSVTable(std::shared_ptr<const void> owner, std::string_view contents,
+           bool completeRowsOnly = false, int parseThreads = 1,
+           const CSVQuery *query = nullptr);
+  // take over a buffer that was read into memory
+  explicit CSVTable(std::string buffer, bool completeRowsOnly = false,
+                    int parseThreads = 1, const CSVQuery *query = nullptr);
+  // the rows of first then second without parsing again: the cells keep
+  // pointing into both tables' bytes, only cells rewritten from escapes
+  // are copied, so neither table needs to outlive the result
+  static CSVTable concat(const CSVTable &first, const CSVTable &second);
+
+  size_t rowCount() const {
+    return parsed.rowStarts.empty() ? 0 : parsed.rowStarts.size() - 1;
+  }
+  size_t size() const { return rowCount(); }
+  bool empty() const { return rowCount() == 0; }
+  size_t byteSize() const { return inputBytes; }
+  // bytes covered by the rows, short of byteSize() when a partial last row
+  // was left out
+  size_t parsedSize() const { return parsedBytes; }
+
+  CSVRow row(size_t i) const {
+    const std::vector<size_t> &starts = parsed.rowStarts;
+    return CSVRow(parsed.cells.data() + starts[i], starts[i + 1] - starts[i]);
+  }
+  CSVRow operator[](size_t i) const { return row(i); }
+  Iterator begin() const { return Iterator(this, 0); }
+  Iterator end() const { return Iterator(this, rowCount()); }
+
+  // owning copy in the shape readAll returns
+  std::vector<std::vector<std::string>> toVectors() const;
+  // the same from resource: a monotonic or pool resource hands out the
+  // memory without the global allocator and releases it all at once
+  PmrRows toVectors(std::pmr::memory_resource *resource) const;
+};
+
+#endif // CSVTABLE_H
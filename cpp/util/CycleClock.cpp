@@ -0,0 +1,90 @@
+#include "CycleClock.h"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// invariant TSC: CPUID.80000007H:EDX[8], constant rate across P/C-states
+bool detectInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+      eax < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1u << 8)) != 0;
+#else
+  return false;
+#endif
+}
+
+long steadyNowNs() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+             chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+double calibrate() {
+#if defined(__aarch64__)
+  uint64_t frequency;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+  return static_cast<double>(frequency) / 1e9;
+#else
+  if (!CycleClock::isHardwareCounter()) {
+    return 1.0; // ticks are already nanoseconds
+  }
+  // measure the TSC rate over a short window against steady_clock
+  long startNs = steadyNowNs();
+  uint64_t startTicks = CycleClock::now();
+  this_thread::sleep_for(chrono::milliseconds(20));
+  long endNs = steadyNowNs();
+  uint64_t endTicks = CycleClock::now();
+  return static_cast<double>(endTicks - startTicks) / (endNs - startNs);
+#endif
+}
+
+} // namespace
+
+atomic<int> CycleClock::tscState{-1};
+
+// racing first callers all compute the same answer
+bool CycleClock::detectTsc() {
+  bool invariant = detectInvariantTsc();
+  tscState.store(invariant ? 1 : 0, memory_order_relaxed);
+  return invariant;
+}
+
+double CycleClock::ticksPerNanosecond() {
+  static const double ratio = calibrate(); // thread-safe, computed once
+  return ratio;
+}
+
+long CycleClock::toNanoseconds(uint64_t ticks) {
+  return static_cast<long>(ticks / ticksPerNanosecond());
+}
+
+long CycleClock::toMicroseconds(uint64_t ticks) {
+  return toNanoseconds(ticks) / 1000;
+}
+
+bool CycleClock::isHardwareCounter() {
+#if defined(__aarch64__)
+  return true;
+#else
+  return useTsc();
+#endif
+}
+
+const char *CycleClock::sourceName() {
+#if defined(__aarch64__)
+  return "cntvct_el0";
+#else
+  return useTsc() ? "TSC" : "steady_clock";
+#endif
+}
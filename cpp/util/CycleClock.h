@@ -0,0 +1,54 @@
+#ifndef CYCLECLOCK_H
+#define CYCLECLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheap timestamp source for hot-path instrumentation.
+// now() returns raw ticks: the invariant TSC on x86, the virtual counter on
+// aarch64, steady_clock nanoseconds everywhere else. Ticks are only converted
+// to time when statistics are read, so the hot path never pays for it.
+class CycleClock {
+public:
+  static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (useTsc()) {
+      return __rdtsc();
+    }
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // conversions, the first call calibrates the TSC against steady_clock
+  static long toNanoseconds(uint64_t ticks);
+  static long toMicroseconds(uint64_t ticks);
+  static double ticksPerNanosecond();
+
+  static bool isHardwareCounter(); // false when falling back to steady_clock
+  static const char *sourceName();
+
+private:
+  // invariant TSC: -1 until the first call, then 0 or 1. Constant-initialized
+  // so callers during static initialization detect it instead of reading a
+  // default and mixing clock sources
+  static std::atomic<int> tscState;
+  static bool detectTsc(); // stores tscState
+
+  static bool useTsc() {
+    int state = tscState.load(std::memory_order_relaxed);
+    return state >= 0 ? state != 0 : detectTsc();
+  }
+};
+
+#endif // CYCLECLOCK_H
@@ -0,0 +1,91 @@
+#include "Histogram.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+long Histogram::upperBound(int bucket) {
+  return bucket == 0 ? 0 : (1L << bucket) - 1;
+}
+
+void Histogram::record(long value) {
+  if (value < 0) {
+    value = 0;
+  }
+  int bucket = 0;
+  if (value > 0) {
+    bucket = 64 - __builtin_clzl(static_cast<unsigned long>(value));
+    if (bucket >= kBucketCount) {
+      bucket = kBucketCount - 1;
+    }
+  }
+  buckets[bucket].fetch_add(1, memory_order_relaxed);
+  count.fetch_add(1, memory_order_relaxed);
+  sum.fetch_add(value, memory_order_relaxed);
+
+  long current = max.load(memory_order_relaxed);
+  while (value > current &&
+         !max.compare_exchange_weak(current, value, memory_order_relaxed)) {
+  }
+}
+
+void Histogram::reset() {
+  for (auto &bucket : buckets) {
+    bucket = 0;
+  }
+  count = 0;
+  sum = 0;
+  max = 0;
+}
+
+long Histogram::getCount() const { return count.load(); }
+
+long Histogram::getSum() const { return sum.load(); }
+
+long Histogram::getMax() const { return max.load(); }
+
+double Histogram::getMean() const {
+  long total = count.load();
+  return total > 0 ? static_cast<double>(sum.load()) / total : 0;
+}
+
+long Histogram::getPercentile(double percentile) const {
+  long total = count.load();
+  if (total == 0) {
+    return 0;
+  }
+  long target = static_cast<long>(total * percentile / 100.0 + 0.5);
+  if (target < 1) {
+    target = 1;
+  }
+  long seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets[i].load();
+    if (seen >= target) {
+      return std::min(upperBound(i), max.load());
+    }
+  }
+  return max.load();
+}
+
+vector<pair<long, long>> Histogram::getBuckets() const {
+  vector<pair<long, long>> result;
+  for (int i = 0; i < kBucketCount; ++i) {
+    long bucketCount = buckets[i].load();
+    if (bucketCount > 0) {
+      result.emplace_back(upperBound(i), bucketCount);
+    }
+  }
+  return result;
+}
+
+string Histogram::toString() const {
+  ostringstream out;
+  for (const auto &[bound, bucketCount] : getBuckets()) {
+    if (out.tellp() > 0) {
+      out << " ";
+    }
+    out << "<=" << bound << ":" << bucketCount;
+  }
+  return out.str();
+}
@@ -0,0 +1,40 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Thread-safe log2-bucketed histogram for latencies and batch sizes.
+// Bucket i counts values in [2^(i-1), 2^i), bucket 0 counts zeros.
+class Histogram {
+public:
+  static const int kBucketCount = 48;
+
+  Histogram() = default;
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  void record(long value);
+  void reset();
+
+  long getCount() const;
+  long getSum() const;
+  long getMax() const;
+  double getMean() const;
+  long getPercentile(double percentile) const; // upper bound of the bucket
+
+  // non-empty buckets as (upper bound, count)
+  std::vector<std::pair<long, long>> getBuckets() const;
+  std::string toString() const; // "<=1:3 <=2:5 ..."
+
+private:
+  std::atomic<long> buckets[kBucketCount] = {};
+  std::atomic<long> count{0};
+  std::atomic<long> sum{0};
+  std::atomic<long> max{0};
+
+  static long upperBound(int bucket);
+};
+
+#endif // HISTOGRAM_H
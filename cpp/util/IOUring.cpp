@@ -0,0 +1,294 @@
+#include "IOUring.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define HAVE_IO_URING 0
+#endif
+
+using namespace std;
+
+#if HAVE_IO_URING
+namespace {
+int ioUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                  minComplete, flags, nullptr, 0));
+}
+
+// one chunk of a request: where it is and how much of it is done
+struct Chunk {
+  char *data;
+  size_t size;
+  uint64_t offset;
+  size_t done = 0;
+  bool endOfFile = false; // a read came back short at end of file
+};
+} // namespace
+#endif
+
+bool IOUring::isSupported() {
+#if HAVE_IO_URING
+  static const bool supported = [] {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = ioUringSetup(1, &params); // seccomp or old kernels refuse
+    if (fd < 0) {
+      return false;
+    }
+    // a ring is not enough: IORING_OP_READ/WRITE need 5.6, and so does the
+    // probe, so a kernel that cannot answer cannot run them either
+    vector<char> buffer(sizeof(io_uring_probe) +
+                        256 * sizeof(io_uring_probe_op));
+    auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+    bool probed = ioUringRegister(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    close(fd);
+    auto opSupported = [probe](unsigned op) {
+      return op <= probe->last_op && op < probe->ops_len &&
+             (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    };
+    return probed && opSupported(IORING_OP_READ) &&
+           opSupported(IORING_OP_WRITE);
+  }();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+IOUring::IOUring(unsigned queueDepth, size_t chunkSize)
+    : queueDepth(queueDepth), chunkSize(chunkSize) {
+#if HAVE_IO_URING
+  if (queueDepth == 0 || chunkSize == 0) {
+    throw invalid_argument("io_uring queue depth and chunk size must be "
+                           "positive");
+  }
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ringFd = ioUringSetup(queueDepth, &params);
+  if (ringFd < 0) {
+    throw runtime_error(string("io_uring_setup failed: ") + strerror(errno));
+  }
+  this->queueDepth = params.sq_entries;
+
+  submitRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  completeRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap) {
+    submitRingSize = completeRingSize = max(submitRingSize, completeRingSize);
+  }
+  submitRing = mmap(nullptr, submitRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+  if (submitRing == MAP_FAILED) {
+    submitRing = nullptr;
+    close(ringFd);
+    throw runtime_error(string("io_uring mmap failed: ") + strerror(errno));
+  }
+  completeRing = submitRing;
+  if (!singleMap) {
+    completeRing = mmap(nullptr, completeRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (completeRing == MAP_FAILED) {
+      completeRing = nullptr;
+      munmap(submitRing, submitRingSize);
+      close(ringFd);
+      throw runtime_error(string("io_uring mmap failed: ") + strerror(errno));
+    }
+  }
+  entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+  entries = mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+  if (entries == MAP_FAILED) {
+    entries = nullptr;
+    if (completeRing != submitRing) {
+      munmap(completeRing, completeRingSize);
+    }
+    munmap(submitRing, submitRingSize);
+    close(ringFd);
+    throw runtime_error(string("io_uring mmap failed: ") + strerror(errno));
+  }
+
+  char *sq = static_cast<char *>(submitRing);
+  submitHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  submitTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  submitMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  submitArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(completeRing);
+  completeHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  completeTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  completeMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  completions = cq + params.cq_off.cqes;
+#else
+  throw runtime_error("io_uring is not available on this platform");
+#endif
+}
+
+IOUring::~IOUring() {
+#if HAVE_IO_URING
+  if (entries != nullptr) {
+    munmap(entries, entriesSize);
+  }
+  if (completeRing != nullptr && completeRing != submitRing) {
+    munmap(completeRing, completeRingSize);
+  }
+  if (submitRing != nullptr) {
+    munmap(submitRing, submitRingSize);
+  }
+  if (ringFd >= 0) {
+    close(ringFd);
+  }
+#endif
+}
+
+// keep up to queueDepth chunks in flight; a chunk that completes short is
+// queued again for its remainder until it is done (or hits end of file)
+size_t IOUring::transfer(bool write, int fd, char *data, size_t size,
+                         uint64_t offset) {
+#if HAVE_IO_URING
+  lock_guard<mutex> guard(ringMutex);
+  vector<Chunk> chunks;
+  for (size_t begin = 0; begin < size; begin += chunkSize) {
+    chunks.push_back({data + begin, min(chunkSize, size - begin),
+                      offset + begin});
+  }
+  vector<size_t> pending; // chunk indexes waiting for a submission slot
+  for (size_t i = chunks.size(); i-- > 0;) {
+    pending.push_back(i); // popped from the back, so in file order
+  }
+
+  unsigned inFlight = 0;
+  string error;
+  while (inFlight > 0 || (!pending.empty() && error.empty())) {
+    // fill free submission slots
+    unsigned tail = *submitTail;
+    unsigned queued = 0;
+    while (!pending.empty() && error.empty() &&
+           inFlight + queued < queueDepth) {
+      size_t index = pending.back();
+      pending.pop_back();
+      Chunk &chunk = chunks[index];
+      unsigned slot = (tail + queued) & submitMask;
+      io_uring_sqe *entry = static_cast<io_uring_sqe *>(entries) + slot;
+      memset(entry, 0, sizeof(*entry));
+      entry->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+      entry->fd = fd;
+      entry->addr = reinterpret_cast<uint64_t>(chunk.data + chunk.done);
+      entry->len = static_cast<uint32_t>(chunk.size - chunk.done);
+      entry->off = chunk.offset + chunk.done;
+      entry->user_data = index;
+      submitArray[slot] = slot;
+      queued++;
+    }
+    if (queued > 0) {
+      __atomic_store_n(submitTail, tail + queued, __ATOMIC_RELEASE);
+    }
+
+    inFlight += queued;
+
+    // submit every entry the kernel has not consumed yet (an interrupted
+    // call may have left some) and wait for at least one completion
+    unsigned unsubmitted =
+        *submitTail - __atomic_load_n(submitHead, __ATOMIC_ACQUIRE);
+    if (ioUringEnter(ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      // the submitted chunks point into the caller's buffer: stop queueing
+      // and keep reaping until the kernel is done with them before failing
+      if (error.empty()) {
+        error = string("io_uring_enter: ") + strerror(errno);
+      }
+      // entries the kernel never consumed must not reach a later call
+      unsigned consumed = __atomic_load_n(submitHead, __ATOMIC_ACQUIRE);
+      inFlight -= *submitTail - consumed;
+      __atomic_store_n(submitTail, consumed, __ATOMIC_RELEASE);
+      if (inFlight > 0) {
+        this_thread::sleep_for(chrono::milliseconds(1)); // e.g. EAGAIN
+      }
+    }
+
+    // reap everything that has completed
+    unsigned head = *completeHead;
+    unsigned completed = __atomic_load_n(completeTail, __ATOMIC_ACQUIRE);
+    for (; head != completed; ++head) {
+      const io_uring_cqe &completion =
+          static_cast<const io_uring_cqe *>(completions)[head & completeMask];
+      Chunk &chunk = chunks[completion.user_data];
+      inFlight--;
+      if (completion.res == -EINTR || completion.res == -EAGAIN) {
+        pending.push_back(completion.user_data);
+      } else if (completion.res < 0) {
+        if (error.empty()) {
+          error = strerror(-completion.res);
+        }
+      } else if (completion.res == 0) {
+        chunk.endOfFile = true; // reads past the end of the file
+        if (write && error.empty()) {
+          error = "write made no progress";
+        }
+      } else {
+        chunk.done += completion.res;
+        if (chunk.done < chunk.size) {
+          pending.push_back(completion.user_data);
+        }
+      }
+    }
+    __atomic_store_n(completeHead, head, __ATOMIC_RELEASE);
+  }
+  if (!error.empty()) {
+    throw runtime_error(string(write ? "io_uring write failed: "
+                                     : "io_uring read failed: ") +
+                        error);
+  }
+
+  // bytes transferred up to the first chunk that stopped at end of file
+  size_t total = 0;
+  for (const Chunk &chunk : chunks) {
+    total += chunk.done;
+    if (chunk.done < chunk.size) {
+      break;
+    }
+  }
+  return total;
+#else
+  (void)write;
+  (void)fd;
+  (void)data;
+  (void)size;
+  (void)offset;
+  throw runtime_error("io_uring is not available on this platform");
+#endif
+}
+
+void IOUring::writeAll(int fd, const char *data, size_t size,
+                       uint64_t offset) {
+  // the kernel only reads from the buffer for writes
+  transfer(true, fd, const_cast<char *>(data), size, offset);
+}
+
+size_t IOUring::readAll(int fd, char *data, size_t size, uint64_t offset) {
+  return transfer(false, fd, data, size, offset);
+}
+
+unsigned IOUring::getQueueDepth() const { return queueDepth; }
+
+size_t IOUring::getChunkSize() const { return chunkSize; }
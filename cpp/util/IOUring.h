@@ -0,0 +1,68 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Minimal io_uring queue over the raw syscalls (no liburing). writeAll and
+// readAll split one request into chunks, keep up to the queue depth of them
+// in flight at once from the calling thread, and reap the completions,
+// resubmitting the rest of any short transfer. Calls are serialized by an
+// internal mutex and synchronous: they return only once every chunk has
+// completed, so a write is a pwrite with extra io_uring_enter calls and
+// only wins when one request spans several chunks. isSupported() reports
+// whether the kernel accepts a ring and supports IORING_OP_READ/WRITE; the
+// constructor throws when there is no ring (or on non-Linux builds). A
+// failed request returns only once no chunk of it is in flight.
+class IOUring {
+private:
+  std::mutex ringMutex; // one request at a time owns the ring
+  int ringFd = -1;
+  unsigned queueDepth = 0;
+  size_t chunkSize;
+
+  // mapped rings, layout described by io_uring_params offsets
+  void *submitRing = nullptr;
+  size_t submitRingSize = 0;
+  void *completeRing = nullptr; // may alias submitRing (single mmap)
+  size_t completeRingSize = 0;
+  void *entries = nullptr; // submission queue entries
+  size_t entriesSize = 0;
+
+  unsigned *submitHead = nullptr;
+  unsigned *submitTail = nullptr;
+  unsigned submitMask = 0;
+  unsigned *submitArray = nullptr;
+  unsigned *completeHead = nullptr;
+  unsigned *completeTail = nullptr;
+  unsigned completeMask = 0;
+  void *completions = nullptr;
+
+  // read (false) or write (true) size bytes at offset, chunked
+  size_t transfer(bool write, int fd, char *data, size_t size,
+                  uint64_t offset);
+
+public:
+  static const unsigned kDefaultQueueDepth = 8;
+  static const size_t kDefaultChunkSize = 256 * 1024;
+
+  explicit IOUring(unsigned queueDepth = kDefaultQueueDepth,
+                   size_t chunkSize = kDefaultChunkSize);
+  ~IOUring();
+
+  IOUring(const IOUring &) = delete;
+  IOUring &operator=(const IOUring &) = delete;
+
+  static bool isSupported(); // probed once, ring and opcodes
+
+  // write all of data at offset; throws on an I/O error
+  void writeAll(int fd, const char *data, size_t size, uint64_t offset);
+  // read up to size bytes at offset, returns fewer only at end of file
+  size_t readAll(int fd, char *data, size_t size, uint64_t offset);
+
+  unsigned getQueueDepth() const;
+  size_t getChunkSize() const;
+};
+
+#endif // IOURING_H
@@ -0,0 +1,169 @@
+#include "LockProfiler.h"
+#include "CycleClock.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+// one aggregation slot per call site, claimed with a CAS on siteKey
+// times are accumulated in CycleClock ticks and converted on report
+struct SiteSlot {
+  atomic<const void *> siteKey{nullptr};
+  atomic<const char *> tag{nullptr};
+  atomic<long> acquisitions{0};
+  atomic<long> contentions{0};
+  atomic<long> totalWaitTicks{0};
+  atomic<long> maxWaitTicks{0};
+  atomic<long> totalHoldTicks{0};
+};
+
+const size_t kSlotCount = 1024; // power of two, open addressing
+SiteSlot slots[kSlotCount];
+SiteSlot overflowSlot; // used once the table is full
+
+SiteSlot &findSlot(const void *siteKey) {
+  size_t hash = reinterpret_cast<uintptr_t>(siteKey);
+  hash ^= hash >> 17;
+  hash *= 0x9E3779B97F4A7C15ull;
+  for (size_t probe = 0; probe < kSlotCount; ++probe) {
+    SiteSlot &slot = slots[(hash + probe) & (kSlotCount - 1)];
+    const void *current = slot.siteKey.load(memory_order_acquire);
+    if (current == siteKey) {
+      return slot;
+    }
+    if (current == nullptr) {
+      if (slot.siteKey.compare_exchange_strong(current, siteKey,
+                                               memory_order_acq_rel) ||
+          current == siteKey) {
+        return slot;
+      }
+    }
+  }
+  return overflowSlot;
+}
+
+void updateMax(atomic<long> &target, long value) {
+  long current = target.load(memory_order_relaxed);
+  while (value > current &&
+         !target.compare_exchange_weak(current, value, memory_order_relaxed)) {
+  }
+}
+
+} // namespace
+
+atomic<bool> LockProfiler::enabled{false};
+
+void LockProfiler::setEnabled(bool on) { enabled.store(on); }
+
+void LockProfiler::record(const void *siteKey, const char *tag, bool contended,
+                          long waitTicks, long holdTicks) {
+  SiteSlot &slot = findSlot(siteKey);
+  if (tag != nullptr) {
+    slot.tag.store(tag, memory_order_relaxed);
+  }
+  slot.acquisitions.fetch_add(1, memory_order_relaxed);
+  if (contended) {
+    slot.contentions.fetch_add(1, memory_order_relaxed);
+  }
+  slot.totalWaitTicks.fetch_add(waitTicks, memory_order_relaxed);
+  slot.totalHoldTicks.fetch_add(holdTicks, memory_order_relaxed);
+  updateMax(slot.maxWaitTicks, waitTicks);
+}
+
+vector<LockProfiler::SiteStats> LockProfiler::getReport() {
+  // merge by name, the same tag literal may live at several addresses
+  map<string, SiteStats> merged;
+  auto merge = [&merged](const SiteSlot &slot, const string &name) {
+    SiteStats &stats = merged[name];
+    stats.site = name;
+    stats.acquisitions += slot.acquisitions.load();
+    stats.contentions += slot.contentions.load();
+    stats.totalWaitNs += CycleClock::toNanoseconds(slot.totalWaitTicks);
+    stats.maxWaitNs =
+        max(stats.maxWaitNs, CycleClock::toNanoseconds(slot.maxWaitTicks));
+    stats.totalHoldNs += CycleClock::toNanoseconds(slot.totalHoldTicks);
+  };
+
+  for (const auto &slot : slots) {
+    const void *siteKey = slot.siteKey.load(memory_order_acquire);
+    if (siteKey == nullptr || slot.acquisitions.load() == 0) {
+      continue;
+    }
+    const char *tag = slot.tag.load();
+    if (tag != nullptr) {
+      merge(slot, tag);
+    } else {
+      // untagged site, resolve with: addr2line -f -C -e RunBenchmark <addr>
+      ostringstream address;
+      address << siteKey;
+      merge(slot, address.str());
+    }
+  }
+  if (overflowSlot.acquisitions.load() > 0) {
+    merge(overflowSlot, "<overflow>");
+  }
+
+  vector<SiteStats> report;
+  for (const auto &entry : merged) {
+    report.push_back(entry.second);
+  }
+  sort(report.begin(), report.end(),
+       [](const SiteStats &a, const SiteStats &b) {
+         return a.totalWaitNs > b.totalWaitNs;
+       });
+  return report;
+}
+
+void LockProfiler::printReport(ostream &os) {
+  auto report = getReport();
+  os << "----- Lock contention by call site (sorted by wait time) -----"
+     << endl;
+  os << left << setw(40) << "Site" << right << setw(12) << "Acquired"
+     << setw(12) << "Contended" << setw(16) << "TotalWait(us)" << setw(14)
+     << "MaxWait(us)" << setw(16) << "TotalHold(us)" << endl;
+  for (const auto &stats : report) {
+    os << left << setw(40) << stats.site << right << setw(12)
+       << stats.acquisitions << setw(12) << stats.contentions << setw(16)
+       << stats.totalWaitNs / 1000 << setw(14) << stats.maxWaitNs / 1000
+       << setw(16) << stats.totalHoldNs / 1000 << endl;
+  }
+}
+
+void LockProfiler::exportReportToCSV(const string &filePath) {
+  ofstream file(filePath);
+  if (!file.is_open()) {
+    cerr << "Failed to open CSV file for writing: " << filePath << endl;
+    return;
+  }
+
+  file << "Site,Acquisitions,Contentions,TotalWait(ns),MaxWait(ns),"
+          "TotalHold(ns)\n";
+  for (const auto &stats : getReport()) {
+    file << stats.site << "," << stats.acquisitions << ","
+         << stats.contentions << "," << stats.totalWaitNs << ","
+         << stats.maxWaitNs << "," << stats.totalHoldNs << "\n";
+  }
+  file.close();
+}
+
+void LockProfiler::reset() {
+  for (auto &slot : slots) {
+    slot.acquisitions = 0;
+    slot.contentions = 0;
+    slot.totalWaitTicks = 0;
+    slot.maxWaitTicks = 0;
+    slot.totalHoldTicks = 0;
+  }
+  overflowSlot.acquisitions = 0;
+  overflowSlot.contentions = 0;
+  overflowSlot.totalWaitTicks = 0;
+  overflowSlot.maxWaitTicks = 0;
+  overflowSlot.totalHoldTicks = 0;
+}
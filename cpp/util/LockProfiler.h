@@ -0,0 +1,41 @@
+#ifndef LOCKPROFILER_H
+#define LOCKPROFILER_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-call-site lock contention profiler (opt-in).
+// When enabled, MutexLock reports every acquisition together with a call-site
+// key: either an explicit tag string or the caller's return address.
+// Statistics are aggregated per site in a fixed lock-free table.
+class LockProfiler {
+public:
+  struct SiteStats {
+    std::string site;      // tag, or hex return address if no tag was given
+    long acquisitions = 0; // number of lock acquisitions
+    long contentions = 0;  // acquisitions that had to wait
+    long totalWaitNs = 0;  // total time spent waiting for the lock (ns)
+    long maxWaitNs = 0;    // longest single wait (ns)
+    long totalHoldNs = 0;  // total time the lock was held (ns)
+  };
+
+  static void setEnabled(bool on);
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  // record one completed acquire/release pair, times in CycleClock ticks
+  static void record(const void *siteKey, const char *tag, bool contended,
+                     long waitTicks, long holdTicks);
+
+  // aggregated stats, sorted by total wait time (hottest site first)
+  static std::vector<SiteStats> getReport();
+  static void printReport(std::ostream &os);
+  static void exportReportToCSV(const std::string &filePath);
+  static void reset();
+
+private:
+  static std::atomic<bool> enabled;
+};
+
+#endif // LOCKPROFILER_H
@@ -0,0 +1,60 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedRegion::MappedRegion(int fd, size_t size) : mappedSize(size) {
+  if (size == 0) {
+    return; // empty file, nothing to map
+  }
+  void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    throw runtime_error(string("mmap failed: ") + strerror(errno));
+  }
+  madvise(address, size, MADV_SEQUENTIAL); // scanned front to back
+  mappedData = static_cast<const char *>(address);
+}
+
+MappedRegion::~MappedRegion() {
+  if (mappedData != nullptr) {
+    munmap(const_cast<char *>(mappedData), mappedSize);
+  }
+}
+
+MappedFile::MappedFile(const string &path) : filePath(path) {
+  fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw runtime_error("Cannot open file for mapping: " + filePath);
+  }
+}
+
+MappedFile::~MappedFile() {
+  current.reset();
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+shared_ptr<const MappedRegion> MappedFile::map() {
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    throw runtime_error("Cannot stat file: " + filePath);
+  }
+  size_t fileSize = fileStat.st_size;
+
+  lock_guard<mutex> lock(mapMutex);
+  if (!current || current->size() != fileSize) {
+    // grown (or truncated): map the new length, old readers keep theirs
+    current = make_shared<const MappedRegion>(fd, fileSize);
+    remapCount++;
+  }
+  return current;
+}
+
+long MappedFile::getRemapCount() const { return remapCount.load(); }
@@ -0,0 +1,50 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// One read-only mapping of a file, unmapped when the last user drops it
+class MappedRegion {
+private:
+  const char *mappedData = nullptr;
+  size_t mappedSize = 0;
+
+public:
+  MappedRegion(int fd, size_t size);
+  ~MappedRegion();
+
+  MappedRegion(const MappedRegion &) = delete;
+  MappedRegion &operator=(const MappedRegion &) = delete;
+
+  const char *data() const { return mappedData; }
+  size_t size() const { return mappedSize; }
+};
+
+// Read-only memory map of a growing file. map() returns a region covering
+// the file's current length and remaps only when the length has changed;
+// readers keep their region alive through the shared_ptr.
+class MappedFile {
+private:
+  std::string filePath;
+  int fd = -1;
+  std::mutex mapMutex; // guards current, held only while (re)mapping
+  std::shared_ptr<const MappedRegion> current;
+  std::atomic<long> remapCount{0};
+
+public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // caller must keep the file from shrinking while it reads the region
+  std::shared_ptr<const MappedRegion> map();
+  long getRemapCount() const;
+};
+
+#endif // MAPPEDFILE_H
@@ -1,9 +1,35 @@
 #include "MutexLock.h"
+#include "CycleClock.h"
+#include "LockProfiler.h"
+#include "TraceRecorder.h"
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <stdexcept>
 using namespace std;
 
+namespace {
+// "held: <tag>", interned for the life of the process because TraceRecorder
+// keeps only the pointer; each thread caches its lookups so the shared
+// table is locked once per tag and thread
+const char *heldSpanName(const char *tag) {
+  thread_local unordered_map<const char *, const char *> cache;
+  auto cached = cache.find(tag);
+  if (cached != cache.end()) {
+    return cached->second;
+  }
+  static mutex internMutex;
+  static unordered_set<string> *interned = new unordered_set<string>();
+  lock_guard<mutex> guard(internMutex);
+  const char *name = interned->insert("held: " + string(tag)).first->c_str();
+  cache.emplace(tag, name);
+  return name;
+}
+} // namespace
+
 MutexLock::MutexLock() : mutexContentionCount(0) {
   if (pthread_mutex_init(&mutex, nullptr) != 0) {
     throw runtime_error("Mutex initialization failed");
@@ -12,17 +38,108 @@ MutexLock::MutexLock() : mutexContentionCount(0) {
 
 MutexLock::~MutexLock() { pthread_mutex_destroy(&mutex); }
 
-void MutexLock::mutexLockOn() {
+void MutexLock::mutexLockOn(const char *site) {
+  mutexLockFrom(__builtin_extract_return_addr(__builtin_return_address(0)),
+                site);
+}
+
+void MutexLock::mutexLockFrom(const void *caller, const char *site) {
+  if (!LockProfiler::isEnabled() && !TraceRecorder::isEnabled()) {
+    if (pthread_mutex_trylock(&mutex) != 0) {
+      mutexContentionCount++;
+      pthread_mutex_lock(&mutex);
+    }
+    return;
+  }
+
+  // profiling or tracing enabled: key the site by tag or by the caller's address
+  const void *siteKey =
+      site != nullptr ? static_cast<const void *>(site) : caller;
+  acquire(siteKey, site);
+}
+
+void MutexLock::acquire(const void *siteKey, const char *tag) {
+  bool tracing = TraceRecorder::isEnabled();
+  uint64_t start = CycleClock::now();
+  bool contended = false;
   if (pthread_mutex_trylock(&mutex) != 0) {
+    contended = true;
     mutexContentionCount++;
+    if (tracing) {
+      TraceRecorder::begin("MutexLock wait", "lock");
+    }
     pthread_mutex_lock(&mutex);
+    if (tracing) {
+      TraceRecorder::end("MutexLock wait", "lock");
+    }
   }
+  uint64_t acquired = CycleClock::now();
+
+  holderTraceName = nullptr;
+  if (tracing) {
+    // named apart from the caller's own span of the same tag
+    holderTraceName = tag != nullptr ? heldSpanName(tag) : "MutexLock held";
+    TraceRecorder::begin(holderTraceName, "lock");
+  }
+
+  if (!LockProfiler::isEnabled()) {
+    return;
+  }
+  holderSite = siteKey;
+  holderTag = tag;
+  holderContended = contended;
+  holderWaitTicks = acquired - start;
+  acquiredAtTicks = acquired;
 }
 
-void MutexLock::mutexUnlock() { pthread_mutex_unlock(&mutex); }
+void MutexLock::mutexUnlock() {
+  if (holderTraceName != nullptr) {
+    TraceRecorder::end(holderTraceName, "lock");
+    holderTraceName = nullptr;
+  }
+  if (holderSite != nullptr) {
+    const void *siteKey = holderSite;
+    long holdTicks = CycleClock::now() - acquiredAtTicks;
+    holderSite = nullptr;
+    LockProfiler::record(siteKey, holderTag, holderContended, holderWaitTicks,
+                         holdTicks);
+  }
+  pthread_mutex_unlock(&mutex);
+}
 
+// the wait releases the mutex: the hold ends here, and once the mutex is
+// reacquired a new hold starts, with the time blocked counted as waiting
 void MutexLock::waitOnCondition(pthread_cond_t *cond) {
+  const char *traceName = holderTraceName;
+  const void *siteKey = holderSite;
+  const char *tag = holderTag;
+  if (traceName != nullptr) {
+    TraceRecorder::end(traceName, "lock");
+    TraceRecorder::begin("MutexLock wait", "lock");
+    holderTraceName = nullptr;
+  }
+  uint64_t start = CycleClock::now();
+  if (siteKey != nullptr) {
+    holderSite = nullptr;
+    LockProfiler::record(siteKey, tag, holderContended, holderWaitTicks,
+                         start - acquiredAtTicks);
+  }
+
   pthread_cond_wait(cond, &mutex);
+
+  uint64_t acquired = CycleClock::now();
+  if (traceName != nullptr) {
+    TraceRecorder::end("MutexLock wait", "lock");
+    TraceRecorder::begin(traceName, "lock");
+    holderTraceName = traceName;
+  }
+  if (siteKey != nullptr) {
+    holderSite = siteKey;
+    holderTag = tag;
+    holderContended = true; // had to get the mutex back
+    holderWaitTicks = acquired - start;
+    acquiredAtTicks = acquired;
+  }
 }
 
 int MutexLock::getContentionCount() const {
@@ -31,4 +148,4 @@ int MutexLock::getContentionCount() const {
 
 int MutexLock::resetContentionCount() {
   return mutexContentionCount.exchange(0);
-}
\ No newline at end of file
+}
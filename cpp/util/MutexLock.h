@@ -2,6 +2,7 @@
 #define MUTEXLOCK_H
 
 #include <atomic>
+#include <cstdint>
 #include <pthread.h>
 
 class MutexLock {
@@ -9,6 +10,16 @@ private:
   pthread_mutex_t mutex;
   std::atomic<int> mutexContentionCount; // record mutex lock contention
 
+  // profiler/trace state of the current holder, only touched while held
+  const void *holderSite = nullptr; // call-site key of the current holder
+  const char *holderTag = nullptr;  // explicit tag, nullptr if return address
+  const char *holderTraceName = nullptr; // open trace span, if tracing
+  bool holderContended = false;
+  long holderWaitTicks = 0;  // CycleClock ticks
+  uint64_t acquiredAtTicks = 0;
+
+  void acquire(const void *siteKey, const char *tag);
+
 public:
   MutexLock();
   ~MutexLock();
@@ -17,7 +28,12 @@ public:
   MutexLock(const MutexLock &) = delete;
   MutexLock &operator=(const MutexLock &) = delete;
 
-  void mutexLockOn();
+  // site: optional call-site tag for LockProfiler, when omitted the caller's
+  // return address is used
+  void mutexLockOn(const char *site = nullptr);
+  // for lock wrappers: caller is the wrapper's own return address, keyed
+  // instead of the wrapper when site is nullptr
+  void mutexLockFrom(const void *caller, const char *site);
   void mutexUnlock();
 
   void waitOnCondition(pthread_cond_t *cond); // wait on condition variable
@@ -1,4 +1,5 @@
 #include "RWLock.h"
+#include "TraceRecorder.h"
 #include <atomic>
 #include <iostream>  // For debugging
 #include <stdexcept> // For exception handling
@@ -14,22 +15,52 @@ RWLock::RWLock() : readContentionByWriteCount(0), writeContentionCount(0) {
 RWLock::~RWLock() { pthread_rwlock_destroy(&rwlock); }
 
 void RWLock::readLock() {
+  bool tracing = TraceRecorder::isEnabled();
   if (pthread_rwlock_tryrdlock(&rwlock) != 0) {
     readContentionByWriteCount++;
+    if (tracing) {
+      TraceRecorder::begin("RWLock read wait", "lock");
+    }
     pthread_rwlock_rdlock(&rwlock); // Block until read lock is acquired
+    if (tracing) {
+      TraceRecorder::end("RWLock read wait", "lock");
+    }
+  }
+  if (tracing) {
+    TraceRecorder::begin("RWLock read held", "lock");
   }
 }
 
 void RWLock::writeLock() {
+  bool tracing = TraceRecorder::isEnabled();
   if (pthread_rwlock_trywrlock(&rwlock) != 0) {
     writeContentionCount++;
+    if (tracing) {
+      TraceRecorder::begin("RWLock write wait", "lock");
+    }
     pthread_rwlock_wrlock(&rwlock); // Block until write lock is acquired
+    if (tracing) {
+      TraceRecorder::end("RWLock write wait", "lock");
+    }
+  }
+  if (tracing) {
+    TraceRecorder::begin("RWLock write held", "lock");
   }
 }
 
-void RWLock::readUnlock() { pthread_rwlock_unlock(&rwlock); }
+void RWLock::readUnlock() {
+  if (TraceRecorder::isEnabled()) {
+    TraceRecorder::end("RWLock read held", "lock");
+  }
+  pthread_rwlock_unlock(&rwlock);
+}
 
-void RWLock::writeUnlock() { pthread_rwlock_unlock(&rwlock); }
+void RWLock::writeUnlock() {
+  if (TraceRecorder::isEnabled()) {
+    TraceRecorder::end("RWLock write held", "lock");
+  }
+  pthread_rwlock_unlock(&rwlock);
+}
 
 int RWLock::getReadContentionByWriteCount() const {
   return readContentionByWriteCount.load(); // read read atomic value
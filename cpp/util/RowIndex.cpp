@@ -0,0 +1,131 @@
+#include "RowIndex.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+void RowIndex::scanLocked(const char *data, size_t size) {
+  const char *position = data;
+  const char *end = data + size;
+  const char *rowStart = data;
+  // next quote at or after position, end if there is none; nullptr until
+  // searched, so quote-free data is scanned for quotes only once
+  const char *quote = nullptr;
+  bool inside = false; // rows begin outside quotes
+
+  while (position < end) {
+    if (inside) {
+      const char *closing = static_cast<const char *>(
+          memchr(position, '"', end - position));
+      if (closing == nullptr) {
+        break; // quoted field continues past the data
+      }
+      inside = false;
+      position = closing + 1;
+      continue;
+    }
+    if (quote != nullptr && quote < position) {
+      quote = nullptr;
+    }
+    if (quote == nullptr) {
+      quote = static_cast<const char *>(memchr(position, '"', end - position));
+    }
+    if (quote == nullptr) {
+      quote = end;
+    }
+    const char *newline =
+        static_cast<const char *>(memchr(position, '\n', quote - position));
+    if (newline == nullptr) {
+      if (quote == end) {
+        break; // no more rows end in this data
+      }
+      inside = true;
+      position = quote + 1;
+      continue;
+    }
+    rowStarts.push_back(indexedEnd + (rowStart - data));
+    position = newline + 1;
+    rowStart = position;
+  }
+
+  indexedEnd += rowStart - data;
+  rowCount.store(rowStarts.size(), memory_order_release);
+}
+
+void RowIndex::append(const char *data, size_t size) {
+  lock_guard<mutex> guard(indexMutex);
+  long before = indexedEnd;
+  if (pending.empty()) {
+    scanLocked(data, size);
+    size_t used = indexedEnd - before;
+    pending.assign(data + used, size - used);
+    return;
+  }
+  // data continues the partial row, rescan it from its start
+  pending.append(data, size);
+  scanLocked(pending.data(), pending.size());
+  pending.erase(0, indexedEnd - before);
+}
+
+void RowIndex::catchUp(int fd) {
+  lock_guard<mutex> guard(indexMutex);
+  const size_t kChunkSize = 1 << 16;
+  string buffer; // file bytes from indexedEnd on
+  long readOffset = indexedEnd;
+  while (true) {
+    size_t kept = buffer.size(); // a partial row from the last chunk
+    buffer.resize(kept + kChunkSize);
+    ssize_t bytesRead = pread(fd, &buffer[kept], kChunkSize, readOffset);
+    if (bytesRead < 0 && errno == EINTR) {
+      buffer.resize(kept);
+      continue;
+    }
+    if (bytesRead < 0) {
+      throw runtime_error(string("Row index scan failed: ") + strerror(errno));
+    }
+    buffer.resize(kept + bytesRead);
+    if (bytesRead == 0) {
+      break; // end of file, a partial row stays pending
+    }
+    readOffset += bytesRead;
+
+    long before = indexedEnd;
+    scanLocked(buffer.data(), buffer.size());
+    buffer.erase(0, indexedEnd - before);
+  }
+  pending = move(buffer); // the partial row read from the file
+}
+
+void RowIndex::rebuild(int fd) {
+  reset();
+  catchUp(fd);
+}
+
+void RowIndex::reset() {
+  lock_guard<mutex> guard(indexMutex);
+  rowStarts.clear();
+  indexedEnd = 0;
+  pending.clear();
+  rowCount.store(0, memory_order_release);
+}
+
+long RowIndex::getIndexedBytes() const {
+  lock_guard<mutex> guard(indexMutex);
+  return indexedEnd;
+}
+
+bool RowIndex::getRange(long first, long last, long &begin,
+                        long &end) const {
+  lock_guard<mutex> guard(indexMutex);
+  long count = rowStarts.size();
+  if (first < 0 || first > last || last > count) {
+    return false;
+  }
+  begin = first < count ? rowStarts[first] : indexedEnd;
+  end = last < count ? rowStarts[last] : indexedEnd;
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef ROWINDEX_H
+#define ROWINDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Append-only in-memory index of row start offsets in a CSV file.
+// Writers that know where their bytes land call append(); otherwise
+// catchUp() scans the bytes added since the last call for row-ending
+// newlines (outside quotes). Only complete rows are indexed; a partial
+// last row is kept until the bytes that complete it arrive.
+class RowIndex {
+private:
+  mutable std::mutex indexMutex; // guards rowStarts, indexedEnd, pending
+  std::vector<long> rowStarts;   // file offset where row i begins
+  long indexedEnd = 0;           // end of the last indexed row
+  std::string pending;           // bytes after indexedEnd, no row end yet
+  std::atomic<long> rowCount{0};
+
+  // index the complete rows in data, which starts at file offset indexedEnd
+  void scanLocked(const char *data, size_t size);
+
+public:
+  // rows just written at the current end of the index
+  void append(const char *data, size_t size);
+  // index the complete rows written to fd past the indexed end
+  void catchUp(int fd);
+  // forget everything and index fd from the start
+  void rebuild(int fd);
+  void reset();
+
+  long getRowCount() const { return rowCount.load(std::memory_order_acquire); }
+  long getIndexedBytes() const;
+  // byte range [begin, end) of rows [first, last), false if out of range
+  bool getRange(long first, long last, long &begin, long &end) const;
+};
+
+#endif // ROWINDEX_H
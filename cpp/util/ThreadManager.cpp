@@ -1,4 +1,5 @@
 #include "ThreadManager.h"
+#include "TraceRecorder.h"
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -11,7 +12,7 @@ ThreadManager::~ThreadManager() {}
 
 //------------------Thread management------------------
 void ThreadManager::createThread(void *(*startRoutine)(void *), void *arg,
-                                 pthread_t *thread) {
+                                 pthread_t *thread, const std::string &name) {
   if (arg != nullptr) {
     int *data = static_cast<int *>(arg);
     if (*data < 0) {
@@ -30,6 +31,8 @@ void ThreadManager::createThread(void *(*startRoutine)(void *), void *arg,
 
   threadList.push_back(*threadPtr);
   threadStatus[*threadPtr] = "Running";
+  TraceRecorder::registerThread(*threadPtr,
+                                name + "-" + to_string(threadList.size()));
 
   cout << "[ThreadManager::createThread] Thread " << *threadPtr
        << " created successfully." << endl;
@@ -19,8 +19,9 @@ public:
   ThreadManager();
   ~ThreadManager();
 
+  // name labels the thread's track in TraceRecorder output
   void createThread(void *(*startRoutine)(void *), void *arg,
-                    pthread_t *thread);
+                    pthread_t *thread, const std::string &name = "Worker");
   void joinAllThreads(); // Join the thread, wait for the thread to finish
 
   // void exitThread(); // Exit the thread
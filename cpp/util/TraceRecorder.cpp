@@ -0,0 +1,229 @@
+#include "TraceRecorder.h"
+#include "CycleClock.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct TraceEvent {
+  uint64_t timestamp; // CycleClock ticks, converted on export
+  const char *name;
+  const char *category;
+  long value; // counter value, unused for other phases
+  char phase; // Chrome trace phase: 'B', 'E', 'i' or 'C'
+};
+
+// per-thread ring buffer, only the owning thread appends to it; the
+// buffer's mutex is uncontended except while an export drains it
+struct ThreadBuffer {
+  mutex bufferMutex;
+  pthread_t thread;
+  int trackId;
+  string name;         // track name, set by registerThread
+  bool exited = false; // the thread is gone, its id may be reused
+  vector<TraceEvent> events;
+  size_t next = 0;
+  bool wrapped = false;
+};
+
+mutex registryMutex; // guards the registry and names, never the hot path
+vector<shared_ptr<ThreadBuffer>> registry;
+// names registered before their thread recorded anything
+unordered_map<pthread_t, string> pendingNames;
+int nextTrackId = 1;
+
+// owns the calling thread's buffer, marks it exited when the thread ends
+struct LocalBuffer {
+  shared_ptr<ThreadBuffer> buffer;
+  ~LocalBuffer() {
+    if (buffer) {
+      lock_guard<mutex> lock(buffer->bufferMutex);
+      buffer->exited = true;
+    }
+  }
+};
+thread_local LocalBuffer localBuffer;
+
+ThreadBuffer &getLocalBuffer() {
+  if (!localBuffer.buffer) {
+    auto buffer = make_shared<ThreadBuffer>();
+    buffer->thread = pthread_self();
+    buffer->events.resize(TraceRecorder::kEventsPerThread);
+    lock_guard<mutex> lock(registryMutex);
+    buffer->trackId = nextTrackId++;
+    auto pending = pendingNames.find(buffer->thread);
+    if (pending != pendingNames.end()) {
+      buffer->name = move(pending->second);
+      pendingNames.erase(pending);
+    }
+    registry.push_back(buffer);
+    localBuffer.buffer = buffer;
+  }
+  return *localBuffer.buffer;
+}
+
+void append(char phase, const char *name, const char *category, long value) {
+  ThreadBuffer &buffer = getLocalBuffer();
+  uint64_t timestamp = CycleClock::now();
+  lock_guard<mutex> lock(buffer.bufferMutex);
+  buffer.events[buffer.next] = {timestamp, name, category, value, phase};
+  if (++buffer.next == buffer.events.size()) {
+    buffer.next = 0;
+    buffer.wrapped = true;
+  }
+}
+
+// a JSON string literal: quotes, backslashes and control bytes escaped
+void writeJsonString(ofstream &file, const char *text) {
+  file << '"';
+  for (const char *c = text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      file << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+      file << escaped;
+    } else {
+      file << *c;
+    }
+  }
+  file << '"';
+}
+
+void writeEvent(ofstream &file, const TraceEvent &event, int trackId,
+                uint64_t baseTicks) {
+  // Chrome trace timestamps are in microseconds
+  long relativeNs = CycleClock::toNanoseconds(event.timestamp - baseTicks);
+  file << ",\n{\"name\":";
+  writeJsonString(file, event.name);
+  file << ",\"ph\":\"" << event.phase << "\",\"ts\":" << relativeNs / 1000
+       << "." << relativeNs % 1000 / 100 << relativeNs % 100 / 10
+       << relativeNs % 10 << ",\"pid\":1,\"tid\":" << trackId;
+  if (event.phase == 'C') {
+    file << ",\"args\":{\"value\":" << event.value << "}";
+  } else {
+    file << ",\"cat\":";
+    writeJsonString(file, event.category);
+  }
+  if (event.phase == 'i') {
+    file << ",\"s\":\"t\"";
+  }
+  file << "}";
+}
+
+} // namespace
+
+atomic<bool> TraceRecorder::enabled{false};
+
+void TraceRecorder::setEnabled(bool on) { enabled.store(on); }
+
+void TraceRecorder::begin(const char *name, const char *category) {
+  append('B', name, category, 0);
+}
+
+void TraceRecorder::end(const char *name, const char *category) {
+  append('E', name, category, 0);
+}
+
+void TraceRecorder::instant(const char *name, const char *category) {
+  append('i', name, category, 0);
+}
+
+void TraceRecorder::counter(const char *name, long value) {
+  append('C', name, "counter", value);
+}
+
+// a live buffer of this thread gets the name now; otherwise the thread has
+// not recorded yet and picks the name up with its first event. Exited
+// buffers are skipped, their pthread_t may now belong to this thread.
+void TraceRecorder::registerThread(pthread_t thread, const string &name) {
+  lock_guard<mutex> lock(registryMutex);
+  for (auto &buffer : registry) {
+    lock_guard<mutex> bufferLock(buffer->bufferMutex);
+    if (!buffer->exited && pthread_equal(buffer->thread, thread)) {
+      buffer->name = name;
+      return;
+    }
+  }
+  pendingNames[thread] = name;
+}
+
+// each buffer is copied and cleared under its own lock, so threads still
+// recording lose nothing and never see a half-reset buffer
+bool TraceRecorder::exportChromeTrace(const string &filePath) {
+  lock_guard<mutex> lock(registryMutex);
+
+  ofstream file(filePath);
+  if (!file.is_open()) {
+    cerr << "Failed to open trace file for writing: " << filePath << endl;
+    return false;
+  }
+
+  struct Track {
+    int trackId;
+    string name;
+    vector<TraceEvent> events; // oldest first
+  };
+  vector<Track> tracks;
+  vector<shared_ptr<ThreadBuffer>> alive;
+  for (auto &buffer : registry) {
+    lock_guard<mutex> bufferLock(buffer->bufferMutex);
+    size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+    size_t first = buffer->wrapped ? buffer->next : 0;
+    if (count > 0) {
+      Track track{buffer->trackId, buffer->name, {}};
+      track.events.reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        track.events.push_back(
+            buffer->events[(first + i) % buffer->events.size()]);
+      }
+      tracks.push_back(move(track));
+    }
+    buffer->next = 0;
+    buffer->wrapped = false;
+    if (!buffer->exited) {
+      alive.push_back(buffer); // drop buffers whose thread has exited
+    }
+  }
+  registry.swap(alive);
+
+  // earliest timestamp becomes t=0
+  uint64_t baseTicks = 0;
+  bool haveBase = false;
+  for (const Track &track : tracks) {
+    uint64_t ts = track.events.front().timestamp;
+    if (!haveBase || ts < baseTicks) {
+      baseTicks = ts;
+      haveBase = true;
+    }
+  }
+
+  file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"ConcurrencyTesting\"}}";
+
+  for (const Track &track : tracks) {
+    string trackName = !track.name.empty()
+                           ? track.name
+                           : "Thread-" + to_string(track.trackId);
+    file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << track.trackId << ",\"args\":{\"name\":";
+    writeJsonString(file, trackName.c_str());
+    file << "}}";
+    for (const TraceEvent &event : track.events) {
+      writeEvent(file, event, track.trackId, baseTicks);
+    }
+  }
+  file << "\n]}\n";
+  file.close();
+
+  cout << "Trace written to " << filePath << endl;
+  return !file.fail();
+}
@@ -0,0 +1,62 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <atomic>
+#include <pthread.h>
+#include <string>
+
+// Low-overhead event tracing for lock, queue and CSV activity (opt-in).
+// Every thread records into its own fixed-size ring buffer under that
+// buffer's mutex, which only an export ever contends for.
+// exportChromeTrace() writes Chrome trace-event JSON (loadable in Perfetto
+// / chrome://tracing) with one track per thread.
+class TraceRecorder {
+public:
+  static const size_t kEventsPerThread = 1 << 15; // ring buffer capacity
+
+  static void setEnabled(bool on);
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  // name and category must be string literals (only the pointer is stored)
+  static void begin(const char *name, const char *category);
+  static void end(const char *name, const char *category);
+  static void instant(const char *name, const char *category);
+  static void counter(const char *name, long value);
+
+  // name the track of a running thread, called by ThreadManager on
+  // creation; ids of exited threads may be reused by the next one
+  static void registerThread(pthread_t thread, const std::string &name);
+
+  // write all buffered events and clear them, safe while threads are still
+  // recording; returns false if the file could not be written
+  static bool exportChromeTrace(const std::string &filePath);
+
+private:
+  static std::atomic<bool> enabled;
+};
+
+// RAII helper, records a begin/end pair around a scope
+class TraceScope {
+private:
+  const char *name;
+  const char *category;
+  bool active;
+
+public:
+  TraceScope(const char *name, const char *category)
+      : name(name), category(category), active(TraceRecorder::isEnabled()) {
+    if (active) {
+      TraceRecorder::begin(name, category);
+    }
+  }
+  ~TraceScope() {
+    if (active) {
+      TraceRecorder::end(name, category);
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#endif // TRACERECORDER_H